@@ -0,0 +1,929 @@
+/**
+ * @file iniBenchmark.cpp
+ * @brief Microbenchmarks for Daniel's INI Handler (MIT License)
+ * @author Daniel McGuire
+ *
+ * Builds a synthetic config of sections x keys x value length (or one of
+ * the IniCorpus shapes), times the public operations and prints the results
+ * as JSON. With --scaling it instead measures each shape at 1x, 2x, 4x and
+ * 8x the given key count and fails if a cost grows faster than expected.
+ * With --parallel it parses each shape at 1 to N threads, reports the
+ * speedup and fails if any parallel parse differs from the serial one.
+ * Global operator new is replaced to count heap allocations, which the
+ * parse_allocations results report per parse.
+ *
+ * @code
+ * iniHandler_bench --sections 1000 --keys 20 --value-length 16 --out results.json
+ * iniHandler_bench --shape crlf --sections 1000 --keys 20
+ * iniHandler_bench --scaling --scale 5000
+ * iniHandler_bench --parallel --threads 8
+ * iniHandler_bench --threads 16
+ * @endcode
+ */
+#include "iniHandler.h"
+#include "iniLayers.h"
+#include "iniLoader.h"
+#include "iniScanner.h"
+#include "iniStream.h"
+#include "iniCorpus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /// Calls to the replaced global operator new below.
+    std::atomic<std::uint64_t> allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    using benchClock = std::chrono::steady_clock;
+
+    struct options {
+        std::size_t sections = 1000;
+        std::size_t keys = 20;
+        std::size_t valueLength = 16;
+        std::size_t iterations = 200;
+        std::size_t batch = 64; ///< Operations per timed sample for the sub-microsecond lookups.
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "iniHandler_bench";
+        std::string out;
+        IniCorpus::shape shape = IniCorpus::shape::uniform;
+        std::uint64_t seed = 1;
+        bool scaling = false;
+        bool parallel = false;
+        std::size_t scale = 2000; ///< Smallest key count of a --scaling run.
+        std::size_t threads = std::max(1u, std::thread::hardware_concurrency()); ///< Most reader threads in the readEntry_threads runs.
+    };
+
+    struct result {
+        std::string name;
+        std::vector<double> samples; ///< Nanoseconds per operation, unless unit says otherwise.
+        std::uint64_t bytes = 0;     ///< Bytes processed per operation, for throughput.
+        const char* unit = "ns";
+    };
+
+    /// Keeps results alive so the timed calls cannot be optimized away.
+    volatile std::size_t sink = 0;
+
+    template <typename F>
+    double timeNs(F&& f)
+    {
+        auto start = benchClock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(benchClock::now() - start).count();
+    }
+
+    IniCorpus::spec corpusSpec(const options& opt)
+    {
+        if (opt.shape != IniCorpus::shape::uniform)
+            return IniCorpus::preset(opt.shape, opt.sections * opt.keys, opt.seed);
+
+        IniCorpus::spec spec;
+        spec.sections = opt.sections;
+        spec.keys = opt.keys;
+        spec.valueLength = opt.valueLength;
+        spec.seed = opt.seed;
+        return spec;
+    }
+
+    void writeText(const std::filesystem::path& path, const std::string& text)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    /// The parser as it was before the scanner: getline plus two substr() copies per entry.
+    std::size_t getlineParse(const std::filesystem::path& path)
+    {
+        std::ifstream in(path);
+        std::vector<IniHandler::iniSection> sections;
+        IniHandler::iniSection* current = nullptr;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty())
+                continue;
+            if (line.front() == '[' && line.back() == ']')
+            {
+                sections.push_back({ line.substr(1, line.size() - 2), {} });
+                current = &sections.back();
+                continue;
+            }
+            auto pos = line.find('=');
+            if (pos == std::string::npos || !current)
+                continue;
+            current->entries.push_back({ line.substr(0, pos), line.substr(pos + 1) });
+        }
+        return sections.size();
+    }
+
+    double percentile(std::vector<double> sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        std::size_t rank = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    double median(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return percentile(samples, 0.5);
+    }
+
+    void writeJson(std::ostream& out, const options& opt, const IniCorpus::spec& spec, std::uint64_t fileBytes, const std::vector<result>& results)
+    {
+        out << "{\n";
+        out << "  \"config\": { \"shape\": \"" << IniCorpus::name(opt.shape) << "\", \"sections\": " << spec.sections
+            << ", \"keys\": " << spec.keys << ", \"value_length\": " << spec.valueLength
+            << ", \"iterations\": " << opt.iterations << ", \"file_bytes\": " << fileBytes
+#ifdef INIHANDLER_STATS
+            << ", \"stats_compiled\": true },\n";
+#else
+            << ", \"stats_compiled\": false },\n";
+#endif
+        out << "  \"scanner_kernel\": \"" << IniScanner::kernelName() << "\",\n";
+        out << "  \"scanner_self_check\": " << (IniScanner::selfCheck() ? "true" : "false") << ",\n";
+        out << "  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const result& r = results[i];
+            std::vector<double> sorted = r.samples;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0;
+            for (double v : sorted)
+                sum += v;
+            double mean = sorted.empty() ? 0 : sum / static_cast<double>(sorted.size());
+
+            out << "    { \"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"samples\": " << sorted.size()
+                << ", \"mean\": " << mean
+                << ", \"p50\": " << percentile(sorted, 0.50)
+                << ", \"p90\": " << percentile(sorted, 0.90)
+                << ", \"p99\": " << percentile(sorted, 0.99)
+                << ", \"max\": " << (sorted.empty() ? 0 : sorted.back());
+            if (r.bytes && mean > 0)
+                out << ", \"mb_per_s\": " << static_cast<double>(r.bytes) / mean * 1e3;
+            out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    bool parseArgs(int argc, char** argv, options& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+            const char* value = nullptr;
+            if (arg == "--sections" && (value = next()))
+                opt.sections = std::strtoull(value, nullptr, 10);
+            else if (arg == "--keys" && (value = next()))
+                opt.keys = std::strtoull(value, nullptr, 10);
+            else if (arg == "--value-length" && (value = next()))
+                opt.valueLength = std::strtoull(value, nullptr, 10);
+            else if (arg == "--iterations" && (value = next()))
+                opt.iterations = std::strtoull(value, nullptr, 10);
+            else if (arg == "--dir" && (value = next()))
+                opt.dir = value;
+            else if (arg == "--out" && (value = next()))
+                opt.out = value;
+            else if (arg == "--shape" && (value = next()) && IniCorpus::fromName(value, opt.shape))
+                continue;
+            else if (arg == "--seed" && (value = next()))
+                opt.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--scaling")
+                opt.scaling = true;
+            else if (arg == "--parallel")
+                opt.parallel = true;
+            else if (arg == "--scale" && (value = next()))
+                opt.scale = std::strtoull(value, nullptr, 10);
+            else if (arg == "--threads" && (value = next()))
+                opt.threads = std::strtoull(value, nullptr, 10);
+            else
+            {
+                std::cerr << "usage: " << argv[0]
+                          << " [--sections N] [--keys N] [--value-length N] [--shape name] [--seed N]"
+                             " [--iterations N] [--threads N] [--dir path] [--out file.json] [--scaling [--scale N]] [--parallel]\n";
+                return false;
+            }
+        }
+        opt.iterations = std::max<std::size_t>(opt.iterations, 1);
+        opt.sections = std::max<std::size_t>(opt.sections, 1);
+        opt.keys = std::max<std::size_t>(opt.keys, 1);
+        opt.scale = std::max<std::size_t>(opt.scale, 1);
+        opt.threads = std::max<std::size_t>(opt.threads, 1);
+        return true;
+    }
+
+    /// Largest file a --scaling run generates for any shape.
+    constexpr std::size_t maxScalingBytes = std::size_t(16) << 20;
+
+    /// One cost measured at several file sizes, with the growth exponent it is allowed.
+    struct scalingMetric {
+        const char* name;
+        double expected; ///< 0 for constant per-operation cost, 1 for linear in file size.
+    };
+
+    /// Median nanoseconds per operation of one metric on a freshly written file, after one untimed warm-up.
+    double measureScaling(const scalingMetric& metric, const std::filesystem::path& path, const IniCorpus::spec& spec,
+                          const std::string& text, std::size_t iterations, std::mt19937_64& rng)
+    {
+        writeText(path, text);
+        IniHandler handler(path);
+        std::string metricName = metric.name;
+        std::vector<double> samples;
+
+        auto anySection = [&] { return IniCorpus::sectionName(spec, rng() % spec.sections); };
+        if (metricName == "parse")
+        {
+            for (std::size_t i = 0; i <= iterations; ++i)
+                samples.push_back(timeNs([&] { handler.reload(); }));
+        }
+        else if (metricName == "readEntry_hit")
+        {
+            handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+            handler.reload();
+            std::vector<std::pair<std::string, std::string>> keys;
+            for (std::size_t i = 0; i < 64; ++i)
+                keys.emplace_back(anySection(), IniCorpus::keyName(rng() % spec.keys));
+            for (std::size_t i = 0; i <= iterations; ++i)
+            {
+                double ns = timeNs([&] {
+                    for (const auto& [section, key] : keys)
+                        sink = sink + handler.readEntry_view(section, key).size();
+                });
+                samples.push_back(ns / static_cast<double>(keys.size()));
+            }
+        }
+        else if (metricName == "writeEntry_atomic" || metricName == "writeEntry_incremental_last")
+        {
+            bool last = metricName == "writeEntry_incremental_last";
+            handler.setSaveMode(last ? IniHandler::saveMode::incremental : IniHandler::saveMode::atomic);
+            for (std::size_t i = 0; i <= iterations; ++i)
+            {
+                std::string section = last ? IniCorpus::sectionName(spec, spec.sections - 1) : anySection();
+                std::string value = "w" + std::to_string(i);
+                samples.push_back(timeNs([&] { handler.writeEntry_str(section, IniCorpus::keyName(0), value); }));
+            }
+        }
+        else if (metricName == "writeSection_append")
+        {
+            handler.setSaveMode(IniHandler::saveMode::append);
+            IniHandler::iniSection section{ "", { { "Key0", "appended" } } };
+            for (std::size_t i = 0; i <= iterations; ++i)
+            {
+                section.name = "Appended" + std::to_string(i);
+                samples.push_back(timeNs([&] { handler.writeSection(section); }));
+            }
+        }
+
+        // The first sample paid for faulting in the buffers and the page cache.
+        if (!samples.empty())
+            samples.erase(samples.begin());
+        return median(samples);
+    }
+
+    /// Runs every metric over every shape at 1x/2x/4x/8x keys; false if any grows faster than allowed.
+    ///
+    /// The exponent is fitted per doubling step as well as over the whole
+    /// range, and a metric fails when its median step grows too fast: a
+    /// cost that is superlinear in the algorithm is steep at every step,
+    /// while one cache or page-fault cliff only shows up in a single step.
+    bool runScaling(const options& opt, std::ostream& out)
+    {
+        static const scalingMetric metrics[] = {
+            { "parse", 1 },
+            { "readEntry_hit", 0 },
+            { "writeEntry_atomic", 1 },
+            { "writeEntry_incremental_last", 0 },
+            { "writeSection_append", 0 },
+        };
+        const std::size_t factors[] = { 1, 2, 4, 8 };
+        const auto path = opt.dir / "scaling.ini";
+        std::mt19937_64 rng(opt.seed);
+        bool allLinear = true;
+        bool firstRow = true;
+
+        out << "{\n  \"scale\": " << opt.scale << ",\n  \"scaling\": [\n";
+        for (IniCorpus::shape kind : IniCorpus::all)
+        {
+            if (kind == IniCorpus::shape::tiny)
+                continue;
+
+            // Shapes with long lines are scaled down so the largest file stays within maxScalingBytes.
+            std::size_t base = opt.scale;
+            std::size_t probe = IniCorpus::generate(IniCorpus::preset(kind, base, opt.seed)).size();
+            std::size_t largest = probe * factors[std::size(factors) - 1];
+            if (largest > maxScalingBytes)
+                base = std::max<std::size_t>(1, base * maxScalingBytes / largest);
+
+            std::vector<IniCorpus::spec> specs;
+            std::vector<std::string> texts;
+            for (std::size_t factor : factors)
+            {
+                specs.push_back(IniCorpus::preset(kind, base * factor, opt.seed));
+                texts.push_back(IniCorpus::generate(specs.back()));
+            }
+
+            for (const scalingMetric& metric : metrics)
+            {
+                // Every duplicate header resolves to the first one, so its "last" section is at the top of the file.
+                double expected = metric.expected;
+                if (kind == IniCorpus::shape::duplicateSections && std::string(metric.name) == "writeEntry_incremental_last")
+                    expected = 1;
+
+                std::vector<double> xs, ys;
+                out << (firstRow ? "" : ",\n") << "    { \"shape\": \"" << IniCorpus::name(kind)
+                    << "\", \"metric\": \"" << metric.name << "\", \"points\": [";
+                firstRow = false;
+                for (std::size_t i = 0; i < specs.size(); ++i)
+                {
+                    double ns = measureScaling(metric, path, specs[i], texts[i], opt.iterations, rng);
+                    std::size_t keys = specs[i].sections * specs[i].keys;
+                    xs.push_back(std::log(static_cast<double>(keys)));
+                    ys.push_back(std::log(std::max(ns, 1.0)));
+                    out << (i ? ", " : "") << "{ \"keys\": " << keys << ", \"ns\": " << ns << " }";
+                }
+
+                // Least-squares slope of log(cost) over log(size).
+                double mx = 0, my = 0;
+                for (std::size_t i = 0; i < xs.size(); ++i)
+                {
+                    mx += xs[i] / static_cast<double>(xs.size());
+                    my += ys[i] / static_cast<double>(ys.size());
+                }
+                double num = 0, den = 0;
+                for (std::size_t i = 0; i < xs.size(); ++i)
+                {
+                    num += (xs[i] - mx) * (ys[i] - my);
+                    den += (xs[i] - mx) * (xs[i] - mx);
+                }
+                double exponent = den > 0 ? num / den : 0;
+
+                std::vector<double> steps;
+                out << "], \"steps\": [";
+                for (std::size_t i = 1; i < xs.size(); ++i)
+                {
+                    steps.push_back((ys[i] - ys[i - 1]) / (xs[i] - xs[i - 1]));
+                    out << (i > 1 ? ", " : "") << steps.back();
+                }
+                double step = median(steps);
+                bool ok = step <= expected + 0.5;
+                allLinear = allLinear && ok;
+                out << "], \"exponent\": " << exponent << ", \"median_step\": " << step << ", \"expected\": " << expected
+                    << ", \"ok\": " << (ok ? "true" : "false") << " }";
+            }
+        }
+        out << "\n  ]\n}\n";
+
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return allLinear;
+    }
+
+    bool sameContents(const IniHandler::iniFile& a, const IniHandler::iniFile& b)
+    {
+        if (a.sections.size() != b.sections.size())
+            return false;
+        for (std::size_t i = 0; i < a.sections.size(); ++i)
+        {
+            const auto& x = a.sections[i];
+            const auto& y = b.sections[i];
+            if (x.name != y.name || x.entries.size() != y.entries.size())
+                return false;
+            for (std::size_t j = 0; j < x.entries.size(); ++j)
+                if (x.entries[j].name != y.entries[j].name || x.entries[j].value != y.entries[j].value)
+                    return false;
+        }
+        return true;
+    }
+
+    /// Parses every shape at 1 to N threads against the serial parse; false if any result differs.
+    bool runParallelParse(const options& opt, std::ostream& out)
+    {
+        // 1, 2, 3 and 4 threads always, for uneven cuts even on small machines, then doubling up to --threads.
+        std::vector<std::size_t> counts = { 1, 2, 3, 4 };
+        for (std::size_t n = 8; n <= opt.threads; n *= 2)
+            counts.push_back(n);
+
+        const auto path = opt.dir / "parallel.ini";
+        const std::size_t iterations = std::min<std::size_t>(opt.iterations, 10);
+        bool allIdentical = true;
+        bool firstRow = true;
+
+        out << "{\n  \"parallel\": [\n";
+        for (IniCorpus::shape kind : IniCorpus::all)
+        {
+            // Grown until every thread count gets two slices' worth of parallelChunkBytes each.
+            const std::size_t target = std::max<std::size_t>(std::size_t(8) << 20, IniHandler::parallelChunkBytes * 2 * counts.back());
+            std::size_t probe = IniCorpus::generate(IniCorpus::preset(kind, opt.scale, opt.seed)).size();
+            std::size_t factor = std::max<std::size_t>(1, target / std::max<std::size_t>(probe, 1));
+            std::string text = IniCorpus::generate(IniCorpus::preset(kind, opt.scale * factor, opt.seed));
+            writeText(path, text);
+
+            IniHandler serial(path);
+            serial.reload();
+            const IniHandler::iniFile expected = serial.readFile();
+
+            out << (firstRow ? "" : ",\n") << "    { \"shape\": \"" << IniCorpus::name(kind)
+                << "\", \"file_bytes\": " << text.size() << ", \"points\": [";
+            firstRow = false;
+            double base = 0;
+            for (std::size_t i = 0; i < counts.size(); ++i)
+            {
+                IniHandler handler(path);
+                handler.setParseThreads(static_cast<unsigned>(counts[i]));
+                std::vector<double> samples;
+                for (std::size_t j = 0; j < iterations; ++j)
+                    samples.push_back(timeNs([&] { handler.reload(); }));
+                bool identical = sameContents(handler.readFile(), expected);
+                allIdentical = allIdentical && identical;
+
+                double ns = median(samples);
+                if (i == 0)
+                    base = ns;
+                out << (i ? ", " : "") << "{ \"threads\": " << counts[i] << ", \"ns\": " << ns
+                    << ", \"speedup\": " << (ns > 0 ? base / ns : 0) << ", \"identical\": " << (identical ? "true" : "false") << " }";
+            }
+            out << "] }";
+        }
+        out << "\n  ]\n}\n";
+
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return allIdentical;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opt;
+    if (!parseArgs(argc, argv, opt))
+        return 2;
+
+    std::filesystem::create_directories(opt.dir);
+
+    if (opt.scaling)
+    {
+        if (opt.out.empty())
+            return runScaling(opt, std::cout) ? 0 : 1;
+
+        std::ofstream out(opt.out);
+        bool linear = runScaling(opt, out);
+        if (!out)
+        {
+            std::cerr << "cannot write " << opt.out << "\n";
+            return 1;
+        }
+        return linear ? 0 : 1;
+    }
+
+    if (opt.parallel)
+    {
+        if (opt.out.empty())
+            return runParallelParse(opt, std::cout) ? 0 : 1;
+
+        std::ofstream out(opt.out);
+        bool identical = runParallelParse(opt, out);
+        if (!out)
+        {
+            std::cerr << "cannot write " << opt.out << "\n";
+            return 1;
+        }
+        return identical ? 0 : 1;
+    }
+
+    const auto configPath = opt.dir / "bench.ini";
+    const IniCorpus::spec spec = corpusSpec(opt);
+    const std::string config = IniCorpus::generate(spec);
+    writeText(configPath, config);
+
+    std::vector<result> results;
+    std::mt19937_64 rng(42);
+
+    // Parse throughput: the resident model is dropped and rebuilt each time.
+    for (auto mode : { IniHandler::parseMode::buffered, IniHandler::parseMode::mapped })
+    {
+        result r{ mode == IniHandler::parseMode::buffered ? "parse_buffered" : "parse_mapped", {}, config.size() };
+        IniHandler handler(configPath);
+        handler.setParseMode(mode);
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+            r.samples.push_back(timeNs([&] { handler.reload(); }));
+        results.push_back(std::move(r));
+    }
+    {
+        // Heap against arena storage: allocations and time per parse, lookups, and dropping the model.
+        std::mt19937_64 pick(7); // Own generator, so the later runs see the same keys as before.
+        std::vector<std::pair<std::string, std::string>> keys;
+        for (std::size_t i = 0; i < opt.batch; ++i)
+            keys.emplace_back(IniCorpus::sectionName(spec, pick() % spec.sections), IniCorpus::keyName(pick() % spec.keys));
+
+        for (auto storage : { IniHandler::storageMode::heap, IniHandler::storageMode::arena })
+        {
+            const std::string suffix = storage == IniHandler::storageMode::heap ? "_heap" : "_arena";
+            result parse{ "parse_storage" + suffix, {}, config.size() };
+            result allocated{ "parse_allocations" + suffix, {}, 0, "allocations" };
+            result lookup{ "readEntry_hit" + suffix, {}, 0 };
+            result teardown{ "teardown" + suffix, {}, 0 };
+
+            IniHandler handler(configPath);
+            handler.setStorageMode(storage);
+            handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+            handler.reload();
+            for (std::size_t i = 0; i < opt.iterations; ++i)
+            {
+                std::uint64_t before = allocations.load(std::memory_order_relaxed);
+                parse.samples.push_back(timeNs([&] { handler.reload(); }));
+                allocated.samples.push_back(static_cast<double>(allocations.load(std::memory_order_relaxed) - before));
+                double ns = timeNs([&] {
+                    for (const auto& [section, key] : keys)
+                        sink = sink + handler.readEntry_view(section, key).size();
+                });
+                lookup.samples.push_back(ns / static_cast<double>(keys.size()));
+            }
+
+            // A fresh handler each time: destroying it frees the whole model.
+            for (std::size_t i = 0; i < std::min<std::size_t>(opt.iterations, 20); ++i)
+            {
+                std::optional<IniHandler> doomed(std::in_place, configPath);
+                doomed->setStorageMode(storage);
+                doomed->reload();
+                teardown.samples.push_back(timeNs([&] { doomed.reset(); }));
+            }
+            for (result* r : { &parse, &allocated, &lookup, &teardown })
+                results.push_back(std::move(*r));
+        }
+    }
+    {
+        // Cold open through the .inic sidecar: the first reload writes it, later ones map it.
+        result r{ "open_compiled", {}, config.size() };
+        IniHandler handler(configPath);
+        handler.setParseMode(IniHandler::parseMode::mapped);
+        handler.setCompiledCache(true);
+        handler.reload();
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+            r.samples.push_back(timeNs([&] { handler.reload(); }));
+        results.push_back(std::move(r));
+    }
+    {
+        // One pass through callbacks with the default chunk size; nothing is kept.
+        result r{ "parse_stream", {}, config.size() };
+        std::size_t entries = 0;
+        IniStream::handlers on;
+        on.onEntry = [&](std::string_view, std::string_view, std::string_view) { return ++entries != 0; };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+            r.samples.push_back(timeNs([&] { IniStream::parse(configPath, on); }));
+        sink = sink + entries;
+        results.push_back(std::move(r));
+    }
+    {
+        result r{ "parse_getline_baseline", {}, config.size() };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+            r.samples.push_back(timeNs([&] { sink = sink + getlineParse(configPath); }));
+        results.push_back(std::move(r));
+    }
+
+    // Lookups are timed in batches; each sample is the mean of one batch.
+    {
+        IniHandler handler(configPath);
+        handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+        handler.reload();
+
+        std::vector<std::pair<std::string, std::string>> hits, misses;
+        for (std::size_t i = 0; i < opt.batch; ++i)
+        {
+            hits.emplace_back(IniCorpus::sectionName(spec, rng() % spec.sections), IniCorpus::keyName(rng() % spec.keys));
+            misses.emplace_back(IniCorpus::sectionName(spec, rng() % spec.sections), "Missing" + std::to_string(i));
+        }
+
+        for (auto* set : { &hits, &misses })
+        {
+            result r{ set == &hits ? "readEntry_hit" : "readEntry_miss", {}, 0 };
+            for (std::size_t i = 0; i < opt.iterations; ++i)
+            {
+                double ns = timeNs([&] {
+                    for (const auto& [section, key] : *set)
+                        sink = sink + handler.readEntry_view(section, key).size();
+                });
+                r.samples.push_back(ns / static_cast<double>(set->size()));
+            }
+            results.push_back(std::move(r));
+        }
+
+        // Copying reads by name against the same keys through handles resolved once.
+        std::vector<IniHandler::keyHandle> handles;
+        for (const auto& [section, key] : hits)
+            handles.push_back(handler.resolve(section, key));
+        result byName{ "readEntry_hit_string", {}, 0 }, byHandle{ "read_handle_hit", {}, 0 };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+        {
+            double ns = timeNs([&] {
+                for (const auto& [section, key] : hits)
+                    sink = sink + handler.readEntry(section, { key, "" }).size();
+            });
+            byName.samples.push_back(ns / static_cast<double>(hits.size()));
+            ns = timeNs([&] {
+                for (auto& handle : handles)
+                    sink = sink + handler.read(handle).size();
+            });
+            byHandle.samples.push_back(ns / static_cast<double>(handles.size()));
+        }
+        results.push_back(std::move(byName));
+        results.push_back(std::move(byHandle));
+
+        result validated{ "readEntry_hit_stat_validated", {}, 0 };
+        handler.setReloadPolicy(IniHandler::reloadPolicy::onChange);
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+        {
+            const auto& [section, key] = hits[i % hits.size()];
+            validated.samples.push_back(timeNs([&] { sink = sink + handler.readEntry_view(section, key).size(); }));
+        }
+        results.push_back(std::move(validated));
+
+        // Aggregate cost per lookup with 1, 2, 4, ... threads reading at once, through the shared
+        // lock and through snapshots; it falls as reads scale. Nothing writes, so the views stay valid.
+        handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+        for (auto lookups : { IniHandler::lookupMode::locked, IniHandler::lookupMode::snapshot })
+        {
+            handler.setLookupMode(lookups);
+            const std::string prefix = lookups == IniHandler::lookupMode::locked ? "readEntry_threads_" : "readEntry_snapshot_threads_";
+            for (std::size_t threads = 1;; threads = std::min(threads * 2, opt.threads))
+            {
+                result r{ prefix + std::to_string(threads), {}, 0 };
+                for (std::size_t run = 0; run < 5; ++run)
+                {
+                    std::atomic<bool> go = false;
+                    std::vector<std::thread> readers;
+                    for (std::size_t t = 0; t < threads; ++t)
+                    {
+                        readers.emplace_back([&, t] {
+                            while (!go.load(std::memory_order_acquire))
+                                std::this_thread::yield();
+                            std::size_t local = 0;
+                            for (std::size_t i = 0; i < opt.iterations; ++i)
+                                for (std::size_t h = 0; h < hits.size(); ++h)
+                                {
+                                    const auto& [section, key] = hits[(h + t) % hits.size()];
+                                    local += handler.readEntry_view(section, key).size();
+                                }
+                            sink = sink + local;
+                        });
+                    }
+                    double ns = timeNs([&] {
+                        go.store(true, std::memory_order_release);
+                        for (auto& reader : readers)
+                            reader.join();
+                    });
+                    r.samples.push_back(ns / static_cast<double>(threads * opt.iterations * hits.size()));
+                }
+                results.push_back(std::move(r));
+                if (threads == opt.threads)
+                    break;
+            }
+        }
+    }
+
+    // Typed reads of numeric values: cached conversions against parsing every time.
+    {
+        const auto typedPath = opt.dir / "typed.ini";
+        std::string typed = "[Typed]\n";
+        std::vector<std::string> keys;
+        for (std::size_t i = 0; i < opt.batch; ++i)
+        {
+            keys.push_back("Value" + std::to_string(i));
+            typed += keys.back() + "=" + std::to_string(rng() % 1000000) + "\n";
+        }
+        writeText(typedPath, typed);
+
+        IniHandler handler(typedPath);
+        handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+        handler.reload();
+
+        auto run = [&](const char* name, auto&& read) {
+            result r{ name, {}, 0 };
+            for (std::size_t i = 0; i < opt.iterations; ++i)
+            {
+                double ns = timeNs([&] {
+                    for (const auto& key : keys)
+                        sink = sink + static_cast<std::size_t>(read(key));
+                });
+                r.samples.push_back(ns / static_cast<double>(keys.size()));
+            }
+            results.push_back(std::move(r));
+        };
+
+        run("get_int_cached", [&](const std::string& key) { return handler.get("Typed", key, 0); });
+        run("get_int_uncached", [&](const std::string& key) {
+            int value = 0;
+            IniValue::parse(handler.readEntry_view("Typed", key), value);
+            return value;
+        });
+        run("readEntry_stoi", [&](const std::string& key) { return std::stoi(handler.readEntry("Typed", { key, "" })); });
+
+        std::vector<IniHandler::keyHandle> handles;
+        for (const auto& key : keys)
+            handles.push_back(handler.resolve("Typed", key));
+        std::size_t next = 0;
+        run("get_int_handle", [&](const std::string&) { return handler.get(handles[next++ % handles.size()], 0); });
+
+        std::error_code ec;
+        std::filesystem::remove(typedPath, ec);
+    }
+
+    // Writes change an existing key, so every call has to reach the disk.
+    for (auto mode : { IniHandler::saveMode::atomic, IniHandler::saveMode::incremental })
+    {
+        writeText(configPath, config);
+        IniHandler handler(configPath);
+        handler.setSaveMode(mode);
+        result r{ mode == IniHandler::saveMode::atomic ? "writeEntry_atomic" : "writeEntry_incremental", {}, 0 };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+        {
+            std::string section = IniCorpus::sectionName(spec, rng() % spec.sections);
+            std::string value = "w" + std::to_string(i);
+            r.samples.push_back(timeNs([&] { handler.writeEntry_str(section, "Key0", value); }));
+        }
+        results.push_back(std::move(r));
+    }
+
+    // writeSection on a file that grows by one section per call.
+    for (auto mode : { IniHandler::saveMode::atomic, IniHandler::saveMode::append })
+    {
+        writeText(configPath, config);
+        IniHandler handler(configPath);
+        handler.setSaveMode(mode);
+        result r{ mode == IniHandler::saveMode::atomic ? "writeSection_growing_atomic" : "writeSection_growing_append", {}, 0 };
+        IniHandler::iniSection section;
+        for (std::size_t k = 0; k < spec.keys; ++k)
+            section.entries.push_back({ IniCorpus::keyName(k), std::string(spec.valueLength, 'n') });
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+        {
+            section.name = "Grown" + std::to_string(i);
+            r.samples.push_back(timeNs([&] { handler.writeSection(section); }));
+        }
+        results.push_back(std::move(r));
+    }
+
+    {
+        writeText(configPath, config);
+        IniHandler handler(configPath);
+        result r{ "empty", {}, 0 };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+            r.samples.push_back(timeNs([&] { sink = sink + handler.empty(); }));
+        results.push_back(std::move(r));
+    }
+
+    // defaults/site/host: a lookup through IniLayers against asking each handler in turn, top first.
+    {
+        IniCorpus::spec overlay = spec;
+        overlay.sections = std::max<std::size_t>(1, spec.sections / 10);
+        const auto sitePath = opt.dir / "site.ini";
+        const auto hostPath = opt.dir / "host.ini";
+        writeText(configPath, config);
+        writeText(sitePath, IniCorpus::generate(overlay));
+        overlay.sections = std::max<std::size_t>(1, spec.sections / 100);
+        writeText(hostPath, IniCorpus::generate(overlay));
+
+        IniHandler defaults(configPath), site(sitePath), host(hostPath);
+        for (IniHandler* h : { &defaults, &site, &host })
+            h->setReloadPolicy(IniHandler::reloadPolicy::never);
+        IniLayers layers({ &defaults, &site, &host });
+
+        std::mt19937_64 pick(7); // Own generator, so the later runs see the same keys as before.
+        std::vector<std::pair<std::string, std::string>> keys;
+        for (std::size_t i = 0; i < opt.batch; ++i)
+            keys.emplace_back(IniCorpus::sectionName(spec, pick() % spec.sections), IniCorpus::keyName(pick() % spec.keys));
+
+        result merged{ "layers_readEntry", {}, 0 };
+        result inTurn{ "layers_handlers_in_turn", {}, 0 };
+        for (std::size_t i = 0; i < opt.iterations; ++i)
+        {
+            merged.samples.push_back(timeNs([&] {
+                for (const auto& [section, key] : keys)
+                    sink = sink + layers.readEntry(section, key).size();
+            }) / static_cast<double>(keys.size()));
+            inTurn.samples.push_back(timeNs([&] {
+                for (const auto& [section, key] : keys)
+                {
+                    std::string value = host.readEntry(section, { key, "" });
+                    if (value.empty())
+                        value = site.readEntry(section, { key, "" });
+                    if (value.empty())
+                        value = defaults.readEntry(section, { key, "" });
+                    sink = sink + value.size();
+                }
+            }) / static_cast<double>(keys.size()));
+        }
+        results.push_back(std::move(merged));
+        results.push_back(std::move(inTurn));
+
+        std::error_code ec;
+        std::filesystem::remove(sitePath, ec);
+        std::filesystem::remove(hostPath, ec);
+    }
+
+    // A conf.d of 80 files, one handler each: opened one after another, then by IniLoader.
+    {
+        const auto confDir = opt.dir / "conf.d";
+        std::filesystem::create_directories(confDir);
+        IniCorpus::spec small = spec;
+        small.sections = std::max<std::size_t>(1, spec.sections / 80);
+        std::vector<std::filesystem::path> paths;
+        for (std::size_t i = 0; i < 80; ++i)
+        {
+            small.seed = spec.seed + i;
+            paths.push_back(confDir / ("conf" + std::to_string(i) + ".ini"));
+            writeText(paths.back(), IniCorpus::generate(small));
+        }
+
+        result serial{ "load_conf_d_serial", {}, 0 };
+        result loader{ "load_conf_d_loader", {}, 0 };
+        IniLoader::settings config;
+        config.threads = static_cast<unsigned>(opt.threads);
+        for (std::size_t i = 0; i < std::min<std::size_t>(opt.iterations, 20); ++i)
+        {
+            serial.samples.push_back(timeNs([&] {
+                for (const auto& path : paths)
+                {
+                    IniHandler handler(path);
+                    sink = sink + handler.reload();
+                }
+            }));
+            loader.samples.push_back(timeNs([&] { sink = sink + IniLoader::load(paths, config).size(); }));
+        }
+        results.push_back(std::move(serial));
+        results.push_back(std::move(loader));
+
+        std::error_code ec;
+        std::filesystem::remove_all(confDir, ec);
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(configPath, ec);
+    std::filesystem::remove(std::filesystem::path(configPath) += "c", ec);
+
+    if (opt.out.empty())
+    {
+        writeJson(std::cout, opt, spec, config.size(), results);
+    }
+    else
+    {
+        std::ofstream out(opt.out);
+        writeJson(out, opt, spec, config.size(), results);
+        if (!out)
+        {
+            std::cerr << "cannot write " << opt.out << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
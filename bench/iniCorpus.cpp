@@ -0,0 +1,132 @@
+/**
+ * @file iniCorpus.cpp
+ * @brief Implementation of the synthetic INI generator (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniCorpus.h"
+
+namespace
+{
+    /// splitmix64: tiny, and unlike the <random> distributions, identical everywhere.
+    struct splitMix {
+        std::uint64_t state;
+
+        std::uint64_t next()
+        {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+    };
+
+    constexpr char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+}
+
+IniCorpus::spec IniCorpus::preset(shape kind, std::size_t keys, std::uint64_t seed)
+{
+    if (keys == 0)
+        keys = 1;
+
+    spec s;
+    s.seed = seed;
+    switch (kind)
+    {
+    case shape::uniform:
+        break;
+    case shape::tiny:
+        s.sections = 1;
+        s.keys = 3;
+        s.valueLength = 8;
+        return s;
+    case shape::manyKeys:
+        s.keys = 1000;
+        break;
+    case shape::longLines:
+        s.keys = 10;
+        s.valueLength = 4096;
+        s.valueJitter = 4096;
+        break;
+    case shape::duplicateSections:
+        s.keys = 1;
+        s.duplicateHeaders = true;
+        break;
+    case shape::crlf:
+        s.crlf = true;
+        break;
+    case shape::comments:
+        s.commentsPerKey = 3;
+        break;
+    }
+    s.sections = (keys + s.keys - 1) / s.keys;
+    return s;
+}
+
+std::string IniCorpus::generate(const spec& s)
+{
+    splitMix rng{ s.seed };
+    const std::string_view eol = s.crlf ? "\r\n" : "\n";
+
+    std::string text;
+    text.reserve(s.sections * (16 + s.keys * (12 + s.valueLength + s.valueJitter / 2 + s.commentsPerKey * 24)));
+    for (std::size_t i = 0; i < s.sections; ++i)
+    {
+        text.append("[").append(sectionName(s, i)).append("]").append(eol);
+        for (std::size_t k = 0; k < s.keys; ++k)
+        {
+            for (std::size_t c = 0; c < s.commentsPerKey; ++c)
+            {
+                if (c % 3 == 2)
+                    text.append(eol);
+                else
+                    text.append(c % 3 == 0 ? "; note " : "# note ").append(std::to_string(rng.next() % 100000)).append(eol);
+            }
+
+            std::size_t length = s.valueLength + (s.valueJitter ? rng.next() % (s.valueJitter + 1) : 0);
+            text.append(keyName(k)).append("=");
+            for (std::size_t v = 0; v < length; ++v)
+                text.push_back(alphabet[rng.next() % (sizeof(alphabet) - 1)]);
+            text.append(eol);
+        }
+        text.append(eol);
+    }
+    return text;
+}
+
+std::string IniCorpus::keyName(std::size_t i)
+{
+    return "Key" + std::to_string(i);
+}
+
+std::string IniCorpus::sectionName(const spec& s, std::size_t i)
+{
+    return s.duplicateHeaders ? std::string("Duplicate") : "Section" + std::to_string(i);
+}
+
+const char* IniCorpus::name(shape kind)
+{
+    switch (kind)
+    {
+    case shape::uniform: return "uniform";
+    case shape::tiny: return "tiny";
+    case shape::manyKeys: return "many-keys";
+    case shape::longLines: return "long-lines";
+    case shape::duplicateSections: return "duplicate-sections";
+    case shape::crlf: return "crlf";
+    case shape::comments: return "comments";
+    }
+    return "";
+}
+
+bool IniCorpus::fromName(std::string_view text, shape& out)
+{
+    for (shape kind : all)
+    {
+        if (text == name(kind))
+        {
+            out = kind;
+            return true;
+        }
+    }
+    return false;
+}
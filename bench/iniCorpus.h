@@ -0,0 +1,65 @@
+/**
+ * @file iniCorpus.h
+ * @brief Deterministic synthetic INI inputs for benchmarks and stress runs (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// @class IniCorpus
+/// @brief Generates reproducible INI files of a given shape and size.
+///
+/// The same spec and seed always produce the same bytes, on every platform.
+class IniCorpus
+{
+public:
+    enum class shape {
+        uniform,           ///< Sections of equal size with fixed-length values.
+        tiny,              ///< A single small section; ignores the scale.
+        manyKeys,          ///< Few, very large sections.
+        longLines,         ///< Values of several kilobytes.
+        duplicateSections, ///< The same header repeated, one key per occurrence.
+        crlf,              ///< Uniform, with "\r\n" line endings.
+        comments           ///< Uniform, with comment and blank lines between the keys.
+    };
+
+    struct spec {
+        std::size_t sections = 100;
+        std::size_t keys = 20;           ///< Keys per section.
+        std::size_t valueLength = 16;
+        std::size_t valueJitter = 0;     ///< Up to this many extra value bytes per key.
+        std::size_t commentsPerKey = 0;
+        bool duplicateHeaders = false;   ///< Every section is named "Duplicate".
+        bool crlf = false;
+        std::uint64_t seed = 1;
+    };
+
+    /**
+     * @brief Spec for a shape holding roughly @p keys keys in total.
+     *
+     * @code
+     * std::string text = IniCorpus::generate(IniCorpus::preset(IniCorpus::shape::manyKeys, 1000000));
+     * @endcode
+     */
+    static spec preset(shape kind, std::size_t keys, std::uint64_t seed = 1);
+
+    /// Renders a spec to INI text.
+    static std::string generate(const spec& s);
+
+    /// Name of the key at index @p i in every section ("Key<i>").
+    static std::string keyName(std::size_t i);
+
+    /// Name of section @p i ("Section<i>", or "Duplicate" for duplicateSections).
+    static std::string sectionName(const spec& s, std::size_t i);
+
+    static const char* name(shape kind);
+
+    /// Looks up a shape by name(); false if there is none.
+    static bool fromName(std::string_view text, shape& out);
+
+    static constexpr shape all[] = { shape::uniform, shape::tiny, shape::manyKeys, shape::longLines,
+                                     shape::duplicateSections, shape::crlf, shape::comments };
+};
@@ -0,0 +1,102 @@
+/**
+ * @file iniCorpusTool.cpp
+ * @brief Command line front end for the synthetic INI generator (MIT License)
+ * @author Daniel McGuire
+ *
+ * @code
+ * iniHandler_corpus --shape crlf --keys 100000 --seed 7 --out crlf.ini
+ * iniHandler_corpus --all --keys 1000000 --dir corpus
+ * @endcode
+ */
+#include "iniCorpus.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    bool writeFile(const std::filesystem::path& path, const std::string& text)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return static_cast<bool>(out);
+    }
+
+    int usage(const char* self)
+    {
+        std::cerr << "usage: " << self << " [--shape name | --all] [--keys N] [--seed N] [--out file | --dir path]\n"
+                  << "shapes:";
+        for (IniCorpus::shape kind : IniCorpus::all)
+            std::cerr << " " << IniCorpus::name(kind);
+        std::cerr << "\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    IniCorpus::shape kind = IniCorpus::shape::uniform;
+    bool all = false;
+    std::size_t keys = 10000;
+    std::uint64_t seed = 1;
+    std::string out;
+    std::filesystem::path dir = ".";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--all")
+        {
+            all = true;
+            continue;
+        }
+        if (!value)
+            return usage(argv[0]);
+        ++i;
+
+        if (arg == "--shape" && !IniCorpus::fromName(value, kind))
+            return usage(argv[0]);
+        else if (arg == "--keys")
+            keys = std::strtoull(value, nullptr, 10);
+        else if (arg == "--seed")
+            seed = std::strtoull(value, nullptr, 10);
+        else if (arg == "--out")
+            out = value;
+        else if (arg == "--dir")
+            dir = value;
+        else if (arg != "--shape")
+            return usage(argv[0]);
+    }
+
+    if (all)
+    {
+        std::filesystem::create_directories(dir);
+        for (IniCorpus::shape each : IniCorpus::all)
+        {
+            auto path = dir / (std::string(IniCorpus::name(each)) + ".ini");
+            if (!writeFile(path, IniCorpus::generate(IniCorpus::preset(each, keys, seed))))
+            {
+                std::cerr << "cannot write " << path << "\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    std::string text = IniCorpus::generate(IniCorpus::preset(kind, keys, seed));
+    if (out.empty())
+    {
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return std::cout ? 0 : 1;
+    }
+    if (!writeFile(out, text))
+    {
+        std::cerr << "cannot write " << out << "\n";
+        return 1;
+    }
+    return 0;
+}
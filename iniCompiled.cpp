@@ -0,0 +1,299 @@
+/**
+ * @file iniCompiled.cpp
+ * @brief Implementation of the compiled INI image (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniCompiled.h"
+
+#include <cstring>
+
+namespace
+{
+    struct header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t sectionCount;
+        std::uint64_t entryCount;
+        std::uint64_t sourceSize;
+        std::int64_t sourceModified;
+        std::uint64_t sourceHash;
+        std::uint64_t sectionSlots;
+        std::uint64_t entrySlots;
+        std::uint64_t checksum; ///< Hash of the image with this field zeroed.
+    };
+
+    constexpr char magic[4] = { 'I', 'N', 'I', 'C' };
+    constexpr std::uint32_t byteOrder = 0x01020304;
+
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    std::uint64_t load64(const char* p)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    /// Smallest power of two with room for count records at half load, at least 8.
+    std::uint64_t slotsFor(std::size_t count)
+    {
+        std::uint64_t slots = 8;
+        while (slots < count * 2)
+            slots *= 2;
+        return slots;
+    }
+
+    /// Bytes from the start of the image to the first record, rounded up to 8.
+    constexpr std::size_t recordsOffset = (sizeof(header) + 7) & ~std::size_t(7);
+
+    /// Covers the header with its checksum field zeroed and every record after it.
+    std::uint64_t checksum(header h, std::string_view records)
+    {
+        h.checksum = 0;
+        std::uint64_t headerHash = IniCompiled::hash({ reinterpret_cast<const char*>(&h), sizeof(h) });
+        return mix(headerHash ^ mix(IniCompiled::hash(records) + 1));
+    }
+}
+
+std::uint64_t IniCompiled::hash(std::string_view bytes)
+{
+    // Four independent lanes keep the multiplies from serialising on large inputs.
+    const char* p = bytes.data();
+    std::size_t n = bytes.size();
+    std::uint64_t lanes[4] = { 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull };
+    while (n >= 32)
+    {
+        for (int i = 0; i < 4; ++i)
+            lanes[i] = (lanes[i] ^ load64(p + i * 8)) * 0x9FB21C651E98DF25ull;
+        p += 32;
+        n -= 32;
+    }
+
+    std::uint64_t h = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3) ^ bytes.size();
+    while (n >= 8)
+    {
+        h = mix(h ^ load64(p));
+        p += 8;
+        n -= 8;
+    }
+    if (n > 0)
+    {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, p, n);
+        h = mix(h ^ tail ^ (std::uint64_t(n) << 56));
+    }
+    return mix(h);
+}
+
+std::uint64_t IniCompiled::entryHash(std::uint32_t sectionIndex, std::string_view key)
+{
+    return mix(hash(key) + (std::uint64_t(sectionIndex) + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+std::string IniCompiled::build(std::string_view source, std::int64_t sourceModified,
+                               const std::vector<section>& sections, const std::vector<entry>& entries)
+{
+    header h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.byteOrder = byteOrder;
+    h.sectionCount = static_cast<std::uint32_t>(sections.size());
+    h.entryCount = entries.size();
+    h.sourceSize = source.size();
+    h.sourceModified = sourceModified;
+    h.sourceHash = hash(source);
+    h.sectionSlots = slotsFor(sections.size());
+    h.entrySlots = slotsFor(entries.size());
+
+    std::vector<slot> sectionTable(h.sectionSlots, slot{ 0, 0 });
+    std::vector<slot> entryTable(h.entrySlots, slot{ 0, 0 });
+    std::vector<section> directory = sections;
+
+    // Same first-occurrence rule as the parser: a later duplicate finds the slot taken.
+    for (std::uint32_t i = 0; i < directory.size(); ++i)
+    {
+        section& s = directory[i];
+        std::string_view name = source.substr(s.offset + 1, s.nameLength);
+        std::uint64_t hs = hash(name);
+        std::uint64_t pos = hs & (h.sectionSlots - 1);
+        s.indexed = 1;
+        for (; sectionTable[pos].index != 0; pos = (pos + 1) & (h.sectionSlots - 1))
+        {
+            const section& other = directory[sectionTable[pos].index - 1];
+            if (sectionTable[pos].tag == std::uint32_t(hs >> 32) && source.substr(other.offset + 1, other.nameLength) == name)
+            {
+                s.indexed = 0;
+                break;
+            }
+        }
+        if (!s.indexed)
+            continue;
+        sectionTable[pos] = { std::uint32_t(hs >> 32), i + 1 };
+
+        for (std::uint32_t e = s.firstEntry; e < s.firstEntry + s.entryCount; ++e)
+        {
+            std::string_view key = source.substr(entries[e].offset, entries[e].nameLength);
+            std::uint64_t he = entryHash(i, key);
+            std::uint64_t slotPos = he & (h.entrySlots - 1);
+            bool duplicate = false;
+            for (; entryTable[slotPos].index != 0; slotPos = (slotPos + 1) & (h.entrySlots - 1))
+            {
+                std::uint32_t other = entryTable[slotPos].index - 1;
+                if (entryTable[slotPos].tag == std::uint32_t(he >> 32) && other >= s.firstEntry && other < e &&
+                    source.substr(entries[other].offset, entries[other].nameLength) == key)
+                {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate)
+                entryTable[slotPos] = { std::uint32_t(he >> 32), e + 1 };
+        }
+    }
+
+    std::string image(recordsOffset, '\0');
+    auto append = [&](const void* data, std::size_t size) { image.append(static_cast<const char*>(data), size); };
+    append(directory.data(), directory.size() * sizeof(section));
+    append(entries.data(), entries.size() * sizeof(entry));
+    append(sectionTable.data(), sectionTable.size() * sizeof(slot));
+    append(entryTable.data(), entryTable.size() * sizeof(slot));
+
+    h.checksum = checksum(h, std::string_view(image).substr(recordsOffset));
+    std::memcpy(image.data(), &h, sizeof(h));
+    return image;
+}
+
+bool IniCompiled::attach(std::string_view image, std::string_view source, std::int64_t sourceModified)
+{
+    detach();
+    if (image.size() < recordsOffset)
+        return false;
+
+    header h;
+    std::memcpy(&h, image.data(), sizeof(h));
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version || h.byteOrder != byteOrder)
+        return false;
+    if (h.sourceSize != source.size() || h.sourceModified != sourceModified)
+        return false;
+
+    // Bounds before anything is dereferenced; table sizes must be powers of two.
+    const std::uint64_t limit = image.size();
+    if (h.sectionSlots == 0 || (h.sectionSlots & (h.sectionSlots - 1)) != 0 || h.entrySlots == 0 || (h.entrySlots & (h.entrySlots - 1)) != 0)
+        return false;
+    if (h.entryCount > limit || h.sectionSlots > limit || h.entrySlots > limit)
+        return false;
+    std::uint64_t expected = recordsOffset + std::uint64_t(h.sectionCount) * sizeof(section) + h.entryCount * sizeof(entry) +
+                             (h.sectionSlots + h.entrySlots) * sizeof(slot);
+    if (expected != limit)
+        return false;
+    if (reinterpret_cast<std::uintptr_t>(image.data()) % alignof(std::uint64_t) != 0)
+        return false;
+
+    if (checksum(h, image.substr(recordsOffset)) != h.checksum)
+        return false;
+    if (hash(source) != h.sourceHash)
+        return false;
+
+    const char* records = image.data() + recordsOffset;
+    const section* sectionRecords = reinterpret_cast<const section*>(records);
+    const entry* entryRecords = reinterpret_cast<const entry*>(records + h.sectionCount * sizeof(section));
+
+    // A matching checksum rules out corruption, not a hand-made image: keep every view inside the source
+    // and every probe sequence finite.
+    for (std::uint32_t i = 0; i < h.sectionCount; ++i)
+    {
+        const section& s = sectionRecords[i];
+        if (s.offset >= source.size() || s.nameLength > source.size() - s.offset - 1 || s.end > source.size() ||
+            std::uint64_t(s.firstEntry) + s.entryCount > h.entryCount)
+            return false;
+    }
+    for (std::uint64_t i = 0; i < h.entryCount; ++i)
+    {
+        const entry& e = entryRecords[i];
+        if (e.offset > source.size() || std::uint64_t(e.nameLength) + e.valueLength + 1 > source.size() - e.offset)
+            return false;
+    }
+
+    // Lookups probe until they meet an empty slot, so a full table would make every miss spin
+    // forever; accept no fuller tables than compile() writes.
+    const slot* tables = reinterpret_cast<const slot*>(records + h.sectionCount * sizeof(section) + h.entryCount * sizeof(entry));
+    auto halfEmpty = [](const slot* table, std::uint64_t count) {
+        std::uint64_t used = 0;
+        for (std::uint64_t i = 0; i < count; ++i)
+            used += table[i].index != 0;
+        return used <= count / 2;
+    };
+    if (!halfEmpty(tables, h.sectionSlots) || !halfEmpty(tables + h.sectionSlots, h.entrySlots))
+        return false;
+
+    text = source;
+    sections = h.sectionCount;
+    entries = h.entryCount;
+    sectionList = sectionRecords;
+    entryList = entryRecords;
+    sectionTable = tables;
+    entryTable = tables + h.sectionSlots;
+    sectionMask = h.sectionSlots - 1;
+    entryMask = h.entrySlots - 1;
+    return true;
+}
+
+const IniCompiled::section* IniCompiled::findSection(std::string_view name, std::uint32_t& index) const
+{
+    if (!attached())
+        return nullptr;
+
+    std::uint64_t h = hash(name);
+    for (std::uint64_t pos = h & sectionMask; sectionTable[pos].index != 0; pos = (pos + 1) & sectionMask)
+    {
+        const slot& s = sectionTable[pos];
+        if (s.tag != std::uint32_t(h >> 32) || s.index > sections)
+            continue;
+        const section& candidate = sectionList[s.index - 1];
+        if (nameOf(candidate) == name)
+        {
+            index = s.index - 1;
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+bool IniCompiled::find(std::string_view sectionName, std::string_view key, std::string_view& value) const
+{
+    std::uint32_t index = 0;
+    const section* s = findSection(sectionName, index);
+    if (!s)
+        return false;
+
+    std::uint64_t h = entryHash(index, key);
+    for (std::uint64_t pos = h & entryMask; entryTable[pos].index != 0; pos = (pos + 1) & entryMask)
+    {
+        const slot& e = entryTable[pos];
+        std::uint64_t candidate = std::uint64_t(e.index) - 1;
+        if (e.tag != std::uint32_t(h >> 32) || candidate < s->firstEntry || candidate >= std::uint64_t(s->firstEntry) + s->entryCount)
+            continue;
+        if (nameOf(entryList[candidate]) == key)
+        {
+            value = valueOf(entryList[candidate]);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IniCompiled::hasEntries(std::string_view sectionName) const
+{
+    std::uint32_t index = 0;
+    const section* s = findSection(sectionName, index);
+    return s && s->entryCount > 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file iniCompiled.h
+ * @brief Binary index of a parsed INI file, stored next to it as a .inic sidecar (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @class IniCompiled
+/// @brief Builds and reads the compiled image of an INI file.
+///
+/// An image holds a section directory, one record per entry and two
+/// open-addressing hash tables (sections by name, entries by section and
+/// key), behind a versioned header with a checksum. Names and values are
+/// not copied: every record points at its line in the source file, whose
+/// size, modification time and content hash the header pins down. The
+/// source text is the string table.
+///
+/// IniCompiled itself is a view; the caller keeps the image and the
+/// source alive while it is attached.
+class IniCompiled
+{
+public:
+    /// One section as it appears in the source.
+    struct section {
+        std::uint64_t offset;     ///< Offset of the "[name]" line.
+        std::uint64_t end;        ///< Offset just past the section's last line.
+        std::uint32_t nameLength;
+        std::uint32_t firstEntry; ///< Index of its first record in the entry list.
+        std::uint32_t entryCount;
+        std::uint32_t indexed;    ///< Non-zero if this is the first section with its name.
+    };
+
+    /// One "name=value" line; the value starts right after the '='.
+    struct entry {
+        std::uint64_t offset;
+        std::uint32_t nameLength;
+        std::uint32_t valueLength;
+    };
+
+    static constexpr std::uint32_t version = 1;
+
+    /**
+     * @brief Builds an image for a source and its sections and entries.
+     *
+     * Entries are listed section by section in file order. Where a section
+     * or key occurs more than once, the index points at the first one.
+     *
+     * @param source The file contents the records point into.
+     * @param sourceModified Modification time of the file in nanoseconds.
+     * @return The image, ready to be written to disk.
+     */
+    static std::string build(std::string_view source, std::int64_t sourceModified,
+                             const std::vector<section>& sections, const std::vector<entry>& entries);
+
+    /**
+     * @brief Validates an image against the source it claims to describe and attaches to both.
+     *
+     * Checks the magic, version, byte order, bounds and checksum of the
+     * image, then the source size, modification time and content hash.
+     *
+     * @return true if the view can be used, false (and detached) otherwise.
+     */
+    bool attach(std::string_view image, std::string_view source, std::int64_t sourceModified);
+
+    /// @brief Forgets the image and source.
+    void detach() { *this = IniCompiled(); }
+
+    bool attached() const { return sectionList != nullptr; }
+
+    /**
+     * @brief Finds the value of a key in the first section with the given name.
+     *
+     * @return true and sets value if found, false otherwise.
+     */
+    bool find(std::string_view sectionName, std::string_view key, std::string_view& value) const;
+
+    /// @brief True if the first section with this name exists and holds at least one entry.
+    bool hasEntries(std::string_view sectionName) const;
+
+    std::size_t sectionCount() const { return sections; }
+    const section& sectionAt(std::size_t i) const { return sectionList[i]; }
+    const entry& entryAt(std::size_t i) const { return entryList[i]; }
+
+    std::string_view nameOf(const section& s) const { return text.substr(s.offset + 1, s.nameLength); }
+    std::string_view nameOf(const entry& e) const { return text.substr(e.offset, e.nameLength); }
+    std::string_view valueOf(const entry& e) const { return text.substr(e.offset + e.nameLength + 1, e.valueLength); }
+
+    /// @brief 64-bit content hash used for the source and the checksum.
+    static std::uint64_t hash(std::string_view bytes);
+
+private:
+    /// Hash table slot: the top half of the hash and the record index plus one; zero is empty.
+    struct slot {
+        std::uint32_t tag;
+        std::uint32_t index;
+    };
+
+    /// Position of a key in the entry table, derived from its section.
+    static std::uint64_t entryHash(std::uint32_t sectionIndex, std::string_view key);
+
+    const section* findSection(std::string_view name, std::uint32_t& index) const;
+
+    std::string_view text;
+    const section* sectionList = nullptr;
+    const entry* entryList = nullptr;
+    const slot* sectionTable = nullptr;
+    const slot* entryTable = nullptr;
+    std::size_t sections = 0;
+    std::size_t entries = 0;
+    std::uint64_t sectionMask = 0;
+    std::uint64_t entryMask = 0;
+};
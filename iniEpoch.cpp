@@ -0,0 +1,118 @@
+/**
+ * @file iniEpoch.cpp
+ * @brief Implementation of the epoch-based reclamation (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniEpoch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    /// One per reading thread, linked into a list that only ever grows; records are reused, never freed.
+    struct readerRecord {
+        std::atomic<std::uint64_t> active = 0; ///< Epoch seen on entering the outermost guard, or 0 when quiescent.
+        std::atomic<bool> inUse = false;
+        readerRecord* next = nullptr;
+        unsigned depth = 0; ///< Only touched by the owning thread.
+    };
+
+    // Starts at 1 so that 0 can mean "not reading".
+    std::atomic<std::uint64_t> globalEpoch = 1;
+    std::atomic<readerRecord*> records = nullptr;
+
+    readerRecord* claimRecord()
+    {
+        for (readerRecord* r = records.load(std::memory_order_acquire); r; r = r->next)
+        {
+            bool expected = false;
+            if (!r->inUse.load(std::memory_order_relaxed) && r->inUse.compare_exchange_strong(expected, true))
+                return r;
+        }
+
+        auto* r = new readerRecord;
+        r->inUse.store(true, std::memory_order_relaxed);
+        r->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        return r;
+    }
+
+    /// Hands the thread's record back for reuse when the thread exits.
+    struct threadRecord {
+        readerRecord* record = claimRecord();
+        ~threadRecord() { record->inUse.store(false, std::memory_order_release); }
+    };
+
+    readerRecord& localRecord()
+    {
+        thread_local threadRecord local;
+        return *local.record;
+    }
+
+    /// Oldest epoch any reader is still in, or the current epoch when none is reading.
+    std::uint64_t oldestActive()
+    {
+        // Pairs with the fence in guard(): either the reader's entry is seen here,
+        // or the reader's pointer load sees what was published before retire().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::uint64_t oldest = globalEpoch.load(std::memory_order_seq_cst);
+        for (readerRecord* r = records.load(std::memory_order_acquire); r; r = r->next)
+        {
+            std::uint64_t active = r->active.load(std::memory_order_seq_cst);
+            if (active != 0)
+                oldest = std::min(oldest, active);
+        }
+        return oldest;
+    }
+}
+
+IniEpoch::guard::guard()
+{
+    readerRecord& r = localRecord();
+    if (r.depth++ == 0)
+    {
+        r.active.store(globalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+IniEpoch::guard::~guard()
+{
+    readerRecord& r = localRecord();
+    if (--r.depth == 0)
+        r.active.store(0, std::memory_order_release);
+}
+
+void IniEpoch::retire(void* object, void (*dispose)(void*))
+{
+    pending.push_back({ object, dispose, globalEpoch.fetch_add(1, std::memory_order_seq_cst) });
+    collect();
+}
+
+void IniEpoch::collect()
+{
+    if (pending.empty())
+        return;
+
+    // A reader that entered at the retire epoch or earlier may still hold the object.
+    std::uint64_t oldest = oldestActive();
+    auto keep = std::partition(pending.begin(), pending.end(), [&](const retired& r) { return r.epoch >= oldest; });
+    for (auto it = keep; it != pending.end(); ++it)
+        it->dispose(it->object);
+    pending.erase(keep, pending.end());
+}
+
+void IniEpoch::drain()
+{
+    collect();
+    while (!pending.empty())
+    {
+        std::this_thread::yield();
+        collect();
+    }
+}
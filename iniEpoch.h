@@ -0,0 +1,72 @@
+/**
+ * @file iniEpoch.h
+ * @brief Epoch-based reclamation for data read without locks (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// @class IniEpoch
+/// @brief Defers freeing retired objects until no reader can still hold them.
+///
+/// Readers wrap each lock-free access in a guard; entering and leaving one
+/// costs two plain stores and a fence, no read-modify-write. A writer
+/// unpublishes an object, then retire()s it; it is freed once every guard
+/// that was open at that point has closed.
+///
+/// One IniEpoch holds the retired objects of one writer. retire(),
+/// collect() and drain() must not be called concurrently on the same
+/// instance; guards may be opened from any thread at any time.
+class IniEpoch
+{
+public:
+    /**
+     * @brief Marks the calling thread as reading until destruction. Guards nest.
+     *
+     * @code
+     * IniEpoch::guard guard;
+     * const snapshot* s = published.load(std::memory_order_acquire);
+     * // ... s stays valid until guard goes out of scope ...
+     * @endcode
+     */
+    class guard {
+    public:
+        guard();
+        ~guard();
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+    };
+
+    IniEpoch() = default;
+    IniEpoch(const IniEpoch&) = delete;
+    IniEpoch& operator=(const IniEpoch&) = delete;
+
+    /// Waits for readers and frees everything still retired.
+    ~IniEpoch() { drain(); }
+
+    /**
+     * @brief Frees an object once all readers that might see it have left.
+     *
+     * The object must already be unreachable for new readers.
+     *
+     * @param object Pointer passed to dispose.
+     * @param dispose Function that frees it.
+     */
+    void retire(void* object, void (*dispose)(void*));
+
+    /// @brief Frees the retired objects no reader can hold any more.
+    void collect();
+
+    /// @brief Blocks until every retired object has been freed.
+    void drain();
+
+private:
+    struct retired {
+        void* object;
+        void (*dispose)(void*);
+        std::uint64_t epoch; ///< Global epoch when it was retired.
+    };
+
+    std::vector<retired> pending;
+};
@@ -4,161 +4,1832 @@
  * @author Daniel McGuire
  */
 #include "iniHandler.h"
+#include "iniScanner.h"
 
-bool IniHandler::writeSection(const iniSection& section)
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+#ifdef INIHANDLER_STATS
+#include <chrono>
+#include <sstream>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef INIHANDLER_STATS
+#define INIHANDLER_COUNT(field, n) (counters.field.fetch_add((n), std::memory_order_relaxed))
+#define INIHANDLER_TIME(op) opTimer timer_(counters.latencies[static_cast<std::size_t>(IniHandler::operation::op)])
+#else
+#define INIHANDLER_COUNT(field, n) ((void)0)
+#define INIHANDLER_TIME(op) ((void)0)
+#endif
+
+namespace
 {
-    if (!readAll())
+#ifdef INIHANDLER_STATS
+    /// Adds the lifetime of the scope to an operation's latency histogram.
+    template <typename Latency>
+    class opTimer {
+    public:
+        explicit opTimer(Latency& target) : target(target), start(std::chrono::steady_clock::now()) {}
+        opTimer(const opTimer&) = delete;
+        opTimer& operator=(const opTimer&) = delete;
+
+        ~opTimer()
+        {
+            auto ns = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            target.count.fetch_add(1, std::memory_order_relaxed);
+            target.totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+            std::uint64_t bound = IniHandler::latencyFirstBucketNs;
+            for (auto& bucket : target.buckets)
+            {
+                if (ns <= bound)
+                {
+                    bucket.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                bound *= 4;
+            }
+        }
+
+    private:
+        Latency& target;
+        std::chrono::steady_clock::time_point start;
+    };
+#endif
+
+    /// Writes the whole buffer to fd, retrying short writes and EINTR.
+    [[maybe_unused]] bool writeFully(int fd, std::string_view bytes)
+    {
+#ifndef _WIN32
+        while (!bytes.empty())
+        {
+            ssize_t written = ::write(fd, bytes.data(), bytes.size());
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes.remove_prefix(static_cast<std::size_t>(written));
+        }
+        return true;
+#else
+        (void)fd;
+        (void)bytes;
         return false;
+#endif
+    }
 
-    bool found = false;
-    for (auto& s : file.sections)
+    /// Writes the whole buffer to fd at offset, retrying short writes and EINTR.
+    [[maybe_unused]] bool writeFullyAt(int fd, std::string_view bytes, std::size_t offset)
     {
-        if (s.name == section.name)
+#ifndef _WIN32
+        while (!bytes.empty())
         {
-            s.entries = section.entries;
-            found = true;
-            break;
+            ssize_t written = ::pwrite(fd, bytes.data(), bytes.size(), static_cast<off_t>(offset));
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes.remove_prefix(static_cast<std::size_t>(written));
+            offset += static_cast<std::size_t>(written);
         }
+        return true;
+#else
+        (void)fd;
+        (void)bytes;
+        (void)offset;
+        return false;
+#endif
     }
 
-    if (!found)
-        file.sections.push_back(section);
+    /// Runs task(0) .. task(count - 1) at once, task(0) on the calling thread.
+    void runParallel(std::size_t count, const std::function<void(std::size_t)>& task)
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(count > 0 ? count - 1 : 0);
+        for (std::size_t i = 1; i < count; ++i)
+            workers.emplace_back(task, i);
+        if (count > 0)
+            task(0);
+        for (auto& worker : workers)
+            worker.join();
+    }
 
-    std::ofstream out(file.path);
-    if (!out.is_open())
-        return false;
+    /// Follows symlinks from path to the file they finally name, which need not exist yet.
+    std::filesystem::path resolveLinks(std::filesystem::path path)
+    {
+        // Bounded like the kernel's own limit, so a link cycle ends at the last link tried.
+        for (int hops = 0; hops < 40; ++hops)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_symlink(std::filesystem::symlink_status(path, ec)))
+                break;
+            std::filesystem::path next = std::filesystem::read_symlink(path, ec);
+            if (ec)
+                break;
+            path = next.is_absolute() ? next : path.parent_path() / next;
+        }
+        return path;
+    }
 
-    for (const auto& s : file.sections)
+    /// Replaces the file link names with bytes by writing a sibling temp file and renaming it over that file.
+    ///
+    /// When link is a symlink, the file it points to is replaced and the link is left alone.
+    bool replaceFile(const std::filesystem::path& link, std::string_view bytes, IniHandler::durability level)
     {
-        out << "[" << s.name << "]\n";
-        for (const auto& entry : s.entries)
-            out << entry.name << "=" << entry.value << "\n";
-        out << "\n";
+        const std::filesystem::path target = resolveLinks(link);
+#ifndef _WIN32
+        std::string temp = target.native() + ".XXXXXX";
+        int fd = ::mkstemp(temp.data());
+        if (fd < 0)
+            return false;
+
+        // mkstemp() creates the file 0600 and owned by us; keep the mode, owner and group of the
+        // file being replaced. Changing the owner needs privileges, so that part is best effort.
+        struct stat st;
+        if (::stat(target.c_str(), &st) == 0)
+        {
+            if (::fchown(fd, st.st_uid, st.st_gid) != 0)
+                (void)::fchown(fd, static_cast<uid_t>(-1), st.st_gid);
+            ::fchmod(fd, st.st_mode & 07777);
+        }
+
+        bool ok = writeFully(fd, bytes);
+        if (ok && level != IniHandler::durability::none)
+        {
+#ifdef __APPLE__
+            ok = ::fsync(fd) == 0;
+#else
+            ok = ::fdatasync(fd) == 0;
+#endif
+        }
+        ok = (::close(fd) == 0) && ok;
+
+        if (!ok || ::rename(temp.c_str(), target.c_str()) != 0)
+        {
+            ::unlink(temp.c_str());
+            return false;
+        }
+
+        if (level == IniHandler::durability::dataAndDirectory)
+        {
+            std::filesystem::path dir = target.parent_path();
+            int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirFd < 0)
+                return false;
+            ok = ::fsync(dirFd) == 0;
+            ::close(dirFd);
+        }
+        return ok;
+#else
+        // No fsync equivalent is wired up here; the rename still keeps readers from seeing a partial file.
+        (void)level;
+        std::filesystem::path temp = target;
+        temp += ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) || !out.flush())
+                return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp, target, ec);
+        if (ec)
+        {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+        return true;
+#endif
     }
-    return true;
 }
 
-bool IniHandler::readSection(const iniSection& section)
+IniHandler::~IniHandler()
+{
+    unwatch();
+    unpublish();
+}
+
+bool IniHandler::watch()
 {
-    if (!readAll())
+#ifdef __linux__
+    std::unique_lock lock(mutex);
+    if (watching)
+        return true;
+
+    int notifyFd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (notifyFd < 0)
+        return false;
+
+    // Watching the directory rather than the file also catches a new file renamed over it.
+    std::filesystem::path dir = path.parent_path();
+    constexpr std::uint32_t events = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+    if (::inotify_add_watch(notifyFd, dir.empty() ? "." : dir.c_str(), events) < 0)
+    {
+        ::close(notifyFd);
         return false;
+    }
 
-    for (const auto& s : file.sections)
+    int stopFd = ::eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0)
     {
-        if (s.name == section.name)
-            return !s.entries.empty();
+        ::close(notifyFd);
+        return false;
     }
 
+    // Start from the current file, so that only later changes are announced.
+    if (!current())
+        readAll();
+
+    watchStop = stopFd;
+    watching = true;
+    watcher = std::thread(&IniHandler::watchLoop, this, notifyFd, stopFd);
+    return true;
+#else
     return false;
+#endif
 }
 
-std::string IniHandler::readEntry_str(const std::string& section, const iniEntry& key)
+void IniHandler::unwatch()
 {
-    return readEntry(section, key);
+#ifdef __linux__
+    std::thread stopping;
+    int stopFd = -1;
+    {
+        std::unique_lock lock(mutex);
+        if (!watching)
+            return;
+        watching = false;
+        stopping = std::move(watcher);
+        stopFd = watchStop;
+        watchStop = -1;
+    }
+
+    // The watcher takes the lock to re-parse, so it is joined without holding it.
+    std::uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(stopFd, &one, sizeof(one));
+    stopping.join();
+    ::close(stopFd);
+#endif
 }
 
-std::string IniHandler::readEntry(const std::string& section, const iniEntry& entry)
+std::size_t IniHandler::subscribe(std::function<void()> callback)
+{
+    std::lock_guard lock(subscribersMutex);
+    subscribers.emplace_back(nextSubscriber, std::move(callback));
+    return nextSubscriber++;
+}
+
+void IniHandler::unsubscribe(std::size_t id)
+{
+    std::lock_guard lock(subscribersMutex);
+    std::erase_if(subscribers, [&](const auto& s) { return s.first == id; });
+}
+
+void IniHandler::watchLoop(int notifyFd, int stopFd)
 {
-    if (!readAll())
-        return "";
+#ifdef __linux__
+    const std::string name = path.filename().string();
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = { { notifyFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
 
-    for (const auto& s : file.sections)
+    for (;;)
     {
-        if (s.name == section)
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+
+        // Drain everything queued so a burst of events costs one re-parse.
+        bool relevant = false;
+        for (;;)
         {
-            for (const auto& src_entry : s.entries)
+            ssize_t length = ::read(notifyFd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+            for (char* p = buffer; p < buffer + length;)
             {
-                if (src_entry.name == entry.name)
-                    return src_entry.value;
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                if ((event->mask & IN_Q_OVERFLOW) || (event->len && name == event->name))
+                    relevant = true;
+                p += sizeof(inotify_event) + event->len;
             }
-            break;
         }
+
+        if (!relevant || !refreshWatched())
+            continue;
+
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard lock(subscribersMutex);
+            for (const auto& s : subscribers)
+                callbacks.push_back(s.second);
+        }
+        for (const auto& callback : callbacks)
+            callback();
     }
-    return "";
+    ::close(notifyFd);
+#else
+    (void)notifyFd;
+    (void)stopFd;
+#endif
 }
 
-bool IniHandler::readAll()
+bool IniHandler::refreshWatched()
 {
-    std::ifstream in(file.path);
-    if (!in.is_open())
+    std::unique_lock lock(mutex);
+
+    // An open batch owns the model until commit(); re-reading would drop its changes.
+    if (batchDepth > 0)
+        return false;
+
+    // Our own saves, and events for a file that is still missing, change nothing.
+    fileStamp now;
+    bool exists = statFile(now);
+    if (loaded ? exists && now == stamp : !exists)
+        return false;
+
+    readAll();
+    return true;
+}
+
+void IniHandler::setLookupMode(lookupMode mode)
+{
+    std::unique_lock lock(mutex);
+    lookups = mode;
+    if (mode == lookupMode::snapshot)
+        publish();
+    else
+        unpublish();
+}
+
+bool IniHandler::writeSection(const iniSection& section)
+{
+    INIHANDLER_TIME(writeSection);
+    std::unique_lock lock(mutex);
+    return replaceSection(section);
+}
+
+bool IniHandler::writeSection(iniSection&& section)
+{
+    INIHANDLER_TIME(writeSection);
+    std::unique_lock lock(mutex);
+    return replaceSection(std::move(section));
+}
+
+template <typename Section>
+bool IniHandler::replaceSection(Section&& section)
+{
+    if (!ensureLoaded())
         return false;
+    thaw();
+
+    if (const sectionIndex* existing = findSection(section.name))
+    {
+        const auto& current = parsed.sections[existing->position].entries;
+        bool same = current.size() == section.entries.size();
+        for (std::size_t i = 0; same && i < current.size(); ++i)
+            same = current[i].name == section.entries[i].name && current[i].value == section.entries[i].value;
+        if (same)
+        {
+            ++elided;
+            return true;
+        }
+    }
 
-    file.sections.clear();
-    std::string line;
-    iniSection* currentSection = nullptr;
+    sectionIndex& target = sectionFor(section.name);
+    auto& entries = parsed.sections[target.position].entries;
+    markDirty(target.position, 0);
 
-    while (std::getline(in, line))
+    // Overwrite the existing slots in place so their names and value strings are reused.
+    bool renamed = entries.size() != section.entries.size();
+    std::size_t count = 0;
+    for (auto& e : section.entries)
     {
-        if (line.empty())
-            continue;
+        nameId id = keep(e.name);
+        if (count == entries.size())
+            entries.push_back({ parsed.names[id], {}, nullptr, npos, id });
+        else if (entries[count].id != id)
+        {
+            entries[count].name = parsed.names[id];
+            entries[count].id = id;
+            renamed = true;
+        }
+
+        entryView& slot = entries[count++];
+        if constexpr (std::is_rvalue_reference_v<Section&&>)
+            assignValue(slot, std::move(e.value));
+        else
+            assignValue(slot, std::string_view(e.value));
+    }
+    entries.resize(count);
+
+    // With the same keys in the same order the key map still holds; rebuilding it would only churn the arena.
+    if (renamed)
+    {
+        ++layoutGeneration;
+        target.entries.clear();
+        indexEntries(target);
+    }
+
+    return save();
+}
 
-        if (line.front() == '[' && line.back() == ']')
+bool IniHandler::readSection(const iniSection& section)
+{
+    INIHANDLER_TIME(readSection);
+    {
+        IniEpoch::guard guard;
+        if (const snapshot* snap = freshSnapshot())
         {
-            file.sections.push_back({ line.substr(1, line.size() - 2), {} });
-            currentSection = &file.sections.back();
-            continue;
+            auto it = snap->sections.find(section.name);
+            bool found = it != snap->sections.end() && !it->second.empty();
+            if (found)
+                INIHANDLER_COUNT(lookupHits, 1);
+            else
+                INIHANDLER_COUNT(lookupMisses, 1);
+            return found;
         }
+    }
 
-        auto pos = line.find('=');
-        if (pos == std::string::npos || !currentSection)
-            continue;
+    auto lock = readLock();
+    if (!lock.owns_lock())
+        return false;
 
-        std::string key = line.substr(0, pos);
-        std::string value = line.substr(pos + 1);
+    const sectionIndex* s = findSection(section.name);
+    bool found = parsed.image ? parsed.compiled.hasEntries(section.name) : s && !s->entries.empty();
+    if (found)
+        INIHANDLER_COUNT(lookupHits, 1);
+    else
+        INIHANDLER_COUNT(lookupMisses, 1);
+    return found;
+}
+
+IniHandler::iniFile IniHandler::readFile()
+{
+    iniFile file;
+    file.path = path;
+
+    auto lock = readLock();
+    if (!lock.owns_lock())
+        return file;
+
+    if (parsed.image)
+    {
+        const IniCompiled& compiled = parsed.compiled;
+        file.sections.reserve(compiled.sectionCount());
+        for (std::size_t i = 0; i < compiled.sectionCount(); ++i)
+        {
+            const IniCompiled::section& s = compiled.sectionAt(i);
+            iniSection& section = file.sections.emplace_back();
+            section.name = compiled.nameOf(s);
+            section.entries.reserve(s.entryCount);
+            for (std::size_t e = s.firstEntry; e < std::size_t(s.firstEntry) + s.entryCount; ++e)
+                section.entries.push_back({ std::string(compiled.nameOf(compiled.entryAt(e))), std::string(compiled.valueOf(compiled.entryAt(e))) });
+        }
+        return file;
+    }
+
+    file.sections.reserve(parsed.sections.size());
+    for (const sectionView& s : parsed.sections)
+    {
+        iniSection& section = file.sections.emplace_back();
+        section.name = s.name;
+        section.entries.reserve(s.entries.size());
+        for (const entryView& e : s.entries)
+            section.entries.push_back({ std::string(e.name), std::string(e.value) });
+    }
+    return file;
+}
+
+bool IniHandler::readChanges(std::uint64_t since, std::vector<iniChange>& changed, std::uint64_t& generation)
+{
+    auto lock = readLock();
+    if (!lock.owns_lock() || since < changeLogStart)
+        return false;
 
-        currentSection->entries.push_back({ key, value });
+    // Sorting groups the records by section, a whole-section record (line 0) first, and drops repeated writes.
+    std::vector<std::pair<std::size_t, std::size_t>> seen;
+    for (auto record = changeLog.rbegin(); record != changeLog.rend() && record->generation > since; ++record)
+        seen.emplace_back(record->section, record->line);
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+
+    changed.clear();
+    for (std::size_t i = 0; i < seen.size();)
+    {
+        auto [position, line] = seen[i];
+        const sectionView& view = parsed.sections[position];
+        iniChange& change = changed.emplace_back();
+        change.section.name = view.name;
+        change.whole = line == 0;
+        if (change.whole)
+            for (const entryView& e : view.entries)
+                change.section.entries.push_back({ std::string(e.name), std::string(e.value) });
+
+        for (; i < seen.size() && seen[i].first == position; ++i)
+        {
+            if (change.whole)
+                continue;
+            const entryView& e = view.entries[seen[i].second - 1];
+            change.section.entries.push_back({ std::string(e.name), std::string(e.value) });
+        }
     }
+
+    generation = changes.load(std::memory_order_acquire);
     return true;
 }
 
-bool IniHandler::writeEntry_str(const std::string& section, const std::string& key, const std::string& value)
+std::string IniHandler::readEntry_str(const std::string& section, const iniEntry& key)
+{
+    return readEntry(section, key);
+}
+
+std::string IniHandler::readEntry(const std::string& section, const iniEntry& entry)
+{
+    INIHANDLER_TIME(readEntry);
+    readPin pin;
+    // Copy while the pin still keeps the value alive.
+    return std::string(find(pin, section, entry.name).text);
+}
+
+std::string_view IniHandler::readEntry_view(std::string_view section, std::string_view key)
+{
+    INIHANDLER_TIME(readEntry);
+    readPin pin;
+    return find(pin, section, key).text;
+}
+
+bool IniHandler::parseEntry(std::string_view section, std::string_view key, bool (*parse)(std::string_view, void*), void* out,
+                            const void* type, std::size_t size)
+{
+    INIHANDLER_TIME(readEntry);
+    readPin pin;
+    return convert(find(pin, section, key), parse, out, type, size);
+}
+
+bool IniHandler::parseHandle(keyHandle& handle, bool (*parse)(std::string_view, void*), void* out, const void* type,
+                             std::size_t size)
+{
+    INIHANDLER_TIME(readEntry);
+    readPin pin;
+    return convert(find(pin, handle.sectionName, handle.keyName, &handle), parse, out, type, size);
+}
+
+bool IniHandler::convert(const foundValue& value, bool (*parse)(std::string_view, void*), void* out, const void* type,
+                         std::size_t size)
 {
-    if (!readAll())
+    if (!value.found)
         return false;
+    // A sidecar has no per-entry cache; convert every time until the first write thaws it.
+    if (!value.typed)
+        return parse(value.text, out);
+    if (type && value.typed->load(type, out, size))
+        return true;
+    if (!parse(value.text, out))
+        return false;
+    if (type)
+        value.typed->store(type, out, size);
+    return true;
+}
+
+IniHandler::keyHandle IniHandler::resolve(std::string_view section, std::string_view key)
+{
+    keyHandle handle;
+    handle.sectionName = section;
+    handle.keyName = key;
+    handle.owner = this; // No position yet, so the first read looks the names up.
+    return handle;
+}
 
-	IniHandler::iniEntry entry{ key, value };
-	return writeEntry(section, entry);
+std::string IniHandler::read(keyHandle& handle)
+{
+    INIHANDLER_TIME(readEntry);
+    readPin pin;
+    return std::string(find(pin, handle.sectionName, handle.keyName, &handle).text);
 }
 
-bool IniHandler::writeEntry(const std::string& section, const iniEntry& entry)
+const IniHandler::entryView* IniHandler::locate(keyHandle& handle)
+{
+    // Missing keys are never cached: writes append sections and entries without moving the layout on.
+    if (handle.owner == this && handle.layout == layoutGeneration && handle.sectionPosition != keyHandle().sectionPosition)
+        return &parsed.sections[handle.sectionPosition].entries[handle.entryPosition];
+
+    // The handle may come from another handler, so forget its snapshot value as well.
+    handle.owner = this;
+    handle.layout = layoutGeneration;
+    handle.sectionPosition = handle.entryPosition = keyHandle().sectionPosition;
+    handle.value = nullptr;
+    handle.version = 0;
+
+    const sectionIndex* s = findSection(handle.sectionName);
+    if (!s)
+        return nullptr;
+    auto it = s->entries.find(idOf(handle.keyName));
+    if (it == s->entries.end())
+        return nullptr;
+
+    handle.sectionPosition = s->position;
+    handle.entryPosition = it->second;
+    return &parsed.sections[s->position].entries[it->second];
+}
+
+IniHandler::foundValue IniHandler::find(readPin& pin, std::string_view section, std::string_view key, keyHandle* handle)
+{
+    foundValue value;
+    pin.epoch.emplace();
+    if (const snapshot* snap = freshSnapshot())
+    {
+        const snapshotValue* v = nullptr;
+        if (!handle)
+            v = snap->find(section, key);
+        else if (handle->owner == this && handle->version == snap->version)
+            v = handle->value;
+        else
+        {
+            handle->owner = this;
+            handle->layout = 0; // Drop the positions too, in case they came from another handler.
+            handle->version = snap->version;
+            v = handle->value = snap->find(section, key);
+        }
+        if (v)
+            value = { true, v->text, &v->typed };
+    }
+    else
+    {
+        // Leave the epoch first: a reader blocked on the lock must not hold back reclamation.
+        pin.epoch.reset();
+        pin.lock = readLock();
+        if (!pin.lock.owns_lock())
+            return value;
+
+        // A sidecar has no positions to remember; look up by name until the first write thaws it.
+        if (parsed.image)
+        {
+            std::string_view text;
+            if (parsed.compiled.find(section, key, text))
+                value = { true, text, nullptr };
+        }
+        else if (const entryView* e = handle ? locate(*handle) : findEntry(section, key))
+            value = { true, e->value, &e->typed };
+    }
+
+    if (value.found)
+        INIHANDLER_COUNT(lookupHits, 1);
+    else
+        INIHANDLER_COUNT(lookupMisses, 1);
+    return value;
+}
+
+bool IniHandler::readAll()
 {
-    if (!readAll())
+    loaded = false;
+    changeLogStart = changes.fetch_add(1, std::memory_order_release) + 1;
+    changeLog.clear();
+    ++layoutGeneration;
+
+    fileStamp current;
+    if (!statFile(current))
+        return false;
+
+    auto source = sourceBuffer::open(path, readMode);
+    if (!source)
         return false;
-    iniSection* targetSection = nullptr;
-    for (auto& s : file.sections)
+
+    INIHANDLER_COUNT(filesOpened, 1);
+    INIHANDLER_COUNT(bytesRead, source->bytes().size());
+
+    std::string_view text = source->bytes();
+    resetModel(parseThreads, text.size());
+    parsed.source = source;
+    parsed.size = text.size();
+    parsed.terminated = text.empty() || text.back() == '\n';
+
+    if (useCompiled)
     {
-        if (s.name == section)
+        auto image = sourceBuffer::open(compiledPath(), parseMode::mapped);
+        if (image && parsed.compiled.attach(image->bytes(), text, current.modified))
         {
-            targetSection = &s;
+            INIHANDLER_COUNT(filesOpened, 1);
+            parsed.image = image;
+            stamp = current;
+            loaded = true;
+            publish();
+            return true;
+        }
+    }
+
+    INIHANDLER_COUNT(parses, 1);
+
+    // One slice per thread, each cut just after a newline.
+    std::size_t slices = std::max<std::size_t>(1, std::min<std::size_t>(parseThreads, text.size() / parallelChunkBytes));
+    std::vector<std::size_t> bounds{ 0 };
+    for (std::size_t i = 1; i < slices; ++i)
+    {
+        std::size_t newline = text.find('\n', std::max(bounds.back(), text.size() / slices * i));
+        if (newline == std::string_view::npos)
             break;
+        bounds.push_back(newline + 1);
+    }
+    bounds.push_back(text.size());
+
+    std::vector<parsedChunk> chunks;
+    chunks.reserve(bounds.size() - 1);
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i)
+        chunks.emplace_back(memoryFor(i));
+    runParallel(chunks.size(), [&](std::size_t i) { scanChunk(text, bounds[i], bounds[i + 1], chunks[i]); });
+
+    // Stitch in file order; entries before the first header of the file are dropped, as always.
+    parsed.sections = std::move(chunks[0].sections);
+    for (std::size_t i = 1; i < chunks.size(); ++i)
+    {
+        parsedChunk& chunk = chunks[i];
+        if (!chunk.leading.empty() && !parsed.sections.empty())
+        {
+            sectionView& last = parsed.sections.back();
+            last.entries.insert(last.entries.end(), std::make_move_iterator(chunk.leading.begin()), std::make_move_iterator(chunk.leading.end()));
+            last.end = chunk.leadingEnd;
         }
+        parsed.sections.insert(parsed.sections.end(), std::make_move_iterator(chunk.sections.begin()), std::make_move_iterator(chunk.sections.end()));
+    }
+
+    buildIndex(static_cast<unsigned>(chunks.size()));
+
+    stamp = current;
+    loaded = true;
+    // Best effort: without a sidecar the next open simply parses again.
+    if (useCompiled)
+        writeCompiled(text);
+    publish();
+    return true;
+}
+
+bool IniHandler::writeAll()
+{
+    if (writeMode != saveMode::atomic && writeTail())
+    {
+        publish();
+        return true;
     }
-    if (!targetSection)
+
+    std::string out;
+    emit(0, 0, 0, out);
+
+    INIHANDLER_COUNT(filesOpened, 1);
+    if (!replaceFile(path, out, syncLevel))
     {
-        file.sections.push_back({ section, {} });
-        targetSection = &file.sections.back();
+        loaded = false;
+        return false;
     }
-    bool found = false;
-    for (auto& e : targetSection->entries)
+    INIHANDLER_COUNT(bytesWritten, out.size());
+    INIHANDLER_COUNT(fullRewrites, 1);
+
+    parsed.size = out.size();
+    parsed.terminated = true;
+    markClean();
+
+    // Our own write must not look like an external change on the next call.
+    if (!statFile(stamp))
+        loaded = false;
+    publish();
+    return true;
+}
+
+bool IniHandler::writeTail()
+{
+#ifdef _WIN32
+    return false;
+#else
+    if (!loaded || parsed.dirtySection == npos)
+        return false;
+
+    std::size_t section = parsed.dirtySection;
+    std::size_t line = parsed.dirtyLine;
+    const sectionView& dirty = parsed.sections[section];
+
+    // Everything from the dirty line on is new when it starts a new section, or
+    // adds entries to the last section on disk; those bytes can simply be appended.
+    bool fresh = line == 0
+        ? dirty.offset == npos
+        : dirty.entries[line - 1].offset == npos
+            && (section + 1 == parsed.sections.size() || parsed.sections[section + 1].offset == npos);
+
+    std::size_t start = parsed.size;
+    if (!fresh)
     {
-        if (e.name == entry.name)
+        // Rewriting a mapped file in place would change the bytes the model still points into.
+        if (writeMode != saveMode::incremental || (parsed.source && parsed.source->isMapped()))
+            return false;
+
+        if (line == 0)
         {
-            e.value = entry.value;
-            found = true;
-            break;
+            start = dirty.offset;
         }
+        else
+        {
+            // New entries follow the section's last line on disk.
+            const entryView& entry = dirty.entries[line - 1];
+            start = entry.offset != npos ? entry.offset : dirty.end;
+        }
+
+        if (start == 0 || start > parsed.size)
+            return false;
     }
-    if (!found)
-        targetSection->entries.push_back(entry);
-    std::ofstream out(file.path);
-    if (!out.is_open())
+
+    // The offsets only describe the file as we last saw it.
+    fileStamp current;
+    if (!statFile(current) || current != stamp)
         return false;
-    for (const auto& s : file.sections)
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC | (fresh ? O_APPEND : 0));
+    if (fd < 0)
+        return false;
+    INIHANDLER_COUNT(filesOpened, 1);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_ino) != stamp.inode || static_cast<std::uint64_t>(st.st_size) != parsed.size)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    std::string out;
+    bool followsLastLine = line == 0 && section > 0 && parsed.sections[section - 1].end == parsed.size;
+    if (start == parsed.size && !parsed.terminated)
+    {
+        // Terminate the last line first; the section it belongs to now ends after that '\n'.
+        out.push_back('\n');
+        if (followsLastLine)
+            ++parsed.sections[section - 1].end;
+    }
+    if (fresh && followsLastLine)
+        out.push_back('\n');
+    emit(section, line, start, out);
+
+    std::size_t size = start + out.size();
+    bool ok = fresh ? writeFully(fd, out) : writeFullyAt(fd, out, start);
+    if (ok && size < parsed.size)
+        ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+    if (ok && syncLevel != durability::none)
     {
-        out << "[" << s.name << "]\n";
-        for (const auto& e : s.entries)
-            out << e.name << "=" << e.value << "\n";
-        out << "\n";
+#ifdef __APPLE__
+        ok = ::fsync(fd) == 0;
+#else
+        ok = ::fdatasync(fd) == 0;
+#endif
     }
+    ok = (::close(fd) == 0) && ok;
+
+    // A failed write leaves the file damaged; the caller's full rewrite repairs it.
+    if (!ok)
+        return false;
+
+    INIHANDLER_COUNT(bytesWritten, out.size());
+    INIHANDLER_COUNT(partialRewrites, 1);
+    parsed.size = size;
+    parsed.terminated = true;
+    markClean();
+
+    if (!statFile(stamp))
+        loaded = false;
     return true;
-}
\ No newline at end of file
+#endif
+}
+
+void IniHandler::emit(std::size_t section, std::size_t line, std::size_t base, std::string& out)
+{
+    for (std::size_t s = section; s < parsed.sections.size(); ++s)
+    {
+        sectionView& view = parsed.sections[s];
+        std::size_t first = 0;
+        if (s == section && line > 0)
+        {
+            first = line - 1;
+        }
+        else
+        {
+            view.offset = base + out.size();
+            out.append("[").append(view.name).append("]\n");
+        }
+
+        for (std::size_t i = first; i < view.entries.size(); ++i)
+        {
+            entryView& e = view.entries[i];
+            e.offset = base + out.size();
+            out.append(e.name).append("=").append(e.value).append("\n");
+        }
+        view.end = base + out.size();
+        out.append("\n");
+    }
+}
+
+void IniHandler::markDirty(std::size_t section, std::size_t line)
+{
+    std::uint64_t generation = changes.fetch_add(1, std::memory_order_release) + 1;
+    if (!changeLog.empty() && changeLog.back().section == section && changeLog.back().line == line)
+    {
+        // Rewriting the same key again and again must not grow the log.
+        changeLog.back().generation = generation;
+    }
+    else
+    {
+        if (changeLog.size() == maxChangeLog)
+        {
+            // Readers further behind than this re-read the whole file instead.
+            changeLog.clear();
+            changeLogStart = generation - 1;
+        }
+        changeLog.push_back({ generation, section, line });
+    }
+    if (parsed.dirtySection == npos || section < parsed.dirtySection || (section == parsed.dirtySection && line < parsed.dirtyLine))
+    {
+        parsed.dirtySection = section;
+        parsed.dirtyLine = line;
+    }
+}
+
+bool IniHandler::save()
+{
+    parsed.dirty = true;
+    if (batchDepth > 0)
+        return true;
+    return writeAll();
+}
+
+void IniHandler::markClean()
+{
+    parsed.dirty = false;
+    parsed.dirtySection = npos;
+    parsed.dirtyLine = 0;
+}
+
+bool IniHandler::commit()
+{
+    INIHANDLER_TIME(commit);
+    std::unique_lock lock(mutex);
+    if (batchDepth == 0)
+        return false;
+
+    if (--batchDepth > 0 || !parsed.dirty)
+        return true;
+
+    return writeAll();
+}
+
+bool IniHandler::rollback()
+{
+    std::unique_lock lock(mutex);
+    batchDepth = 0;
+    return readAll();
+}
+
+bool IniHandler::reload()
+{
+    INIHANDLER_TIME(reload);
+    std::unique_lock lock(mutex);
+    return readAll();
+}
+
+bool IniHandler::refresh()
+{
+    return readLock().owns_lock();
+}
+
+bool IniHandler::ensureLoaded()
+{
+    return current() || readAll();
+}
+
+bool IniHandler::compile()
+{
+    std::unique_lock lock(mutex);
+    if (!ensureLoaded() || parsed.dirty)
+        return false;
+    if (parsed.image)
+        return true;
+
+    // The model holds offsets, not necessarily the text; read what they point into.
+    auto source = sourceBuffer::open(path, parseMode::mapped);
+    fileStamp now;
+    if (!source || !statFile(now) || now != stamp)
+        return false;
+    INIHANDLER_COUNT(filesOpened, 1);
+    return writeCompiled(source->bytes());
+}
+
+void IniHandler::thaw()
+{
+    if (!parsed.image)
+        return;
+
+    const IniCompiled& compiled = parsed.compiled;
+    parsed.sections.reserve(compiled.sectionCount());
+    for (std::size_t i = 0; i < compiled.sectionCount(); ++i)
+    {
+        const IniCompiled::section& s = compiled.sectionAt(i);
+        sectionView& view = parsed.sections.emplace_back(sectionView{ compiled.nameOf(s), entryList(memoryFor(0)), s.offset, s.end });
+        view.entries.reserve(s.entryCount);
+        for (std::size_t e = s.firstEntry; e < std::size_t(s.firstEntry) + s.entryCount; ++e)
+        {
+            const IniCompiled::entry& record = compiled.entryAt(e);
+            view.entries.push_back({ compiled.nameOf(record), compiled.valueOf(record), nullptr, record.offset });
+        }
+    }
+
+    buildIndex(parseThreads);
+    ++layoutGeneration;
+
+    parsed.compiled.detach();
+    parsed.image.reset();
+}
+
+bool IniHandler::writeCompiled(std::string_view text)
+{
+    std::vector<IniCompiled::section> sections;
+    std::vector<IniCompiled::entry> entries;
+    sections.reserve(parsed.sections.size());
+
+    // Every name and value must sit where a parse of text would find it.
+    auto at = [&](std::size_t offset, std::string_view expected) {
+        return offset <= text.size() && text.size() - offset >= expected.size() && text.compare(offset, expected.size(), expected) == 0;
+    };
+    for (const sectionView& s : parsed.sections)
+    {
+        if (s.offset == npos || s.end == npos || !at(s.offset + 1, s.name))
+            return false;
+        sections.push_back({ s.offset, s.end, static_cast<std::uint32_t>(s.name.size()),
+                             static_cast<std::uint32_t>(entries.size()), static_cast<std::uint32_t>(s.entries.size()), 0 });
+        for (const entryView& e : s.entries)
+        {
+            if (e.offset == npos || !at(e.offset, e.name) || !at(e.offset + e.name.size() + 1, e.value))
+                return false;
+            entries.push_back({ e.offset, static_cast<std::uint32_t>(e.name.size()), static_cast<std::uint32_t>(e.value.size()) });
+        }
+    }
+
+    std::string image = IniCompiled::build(text, stamp.modified, sections, entries);
+    INIHANDLER_COUNT(filesOpened, 1);
+    if (!replaceFile(compiledPath(), image, durability::none))
+        return false;
+    INIHANDLER_COUNT(bytesWritten, image.size());
+    return true;
+}
+
+std::filesystem::path IniHandler::compiledPath() const
+{
+    std::filesystem::path sidecar = path;
+    sidecar += "c";
+    return sidecar;
+}
+
+bool IniHandler::current() const
+{
+    if (!loaded)
+        return false;
+
+    // An open batch owns the model until commit(); re-reading would drop its changes.
+    if (policy == reloadPolicy::never || watching || batchDepth > 0)
+        return true;
+
+    fileStamp now;
+    return statFile(now) && now == stamp;
+}
+
+std::shared_lock<IniHandler::rwMutex> IniHandler::readLock()
+{
+    std::shared_lock shared(mutex);
+    if (current())
+        return shared;
+
+    // The lock cannot be upgraded: re-parse exclusively, then share again.
+    shared.unlock();
+    {
+        std::unique_lock exclusive(mutex);
+        if (!ensureLoaded())
+            return {};
+    }
+    shared.lock();
+
+    // Another thread may have failed to re-read the file in between.
+    if (!loaded)
+        return {};
+    return shared;
+}
+
+void IniHandler::rwMutex::lock()
+{
+    waiting.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard hold(gate);
+        shared.lock();
+    }
+    waiting.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void IniHandler::rwMutex::lock_shared()
+{
+    // Queue behind a waiting writer instead of extending the current read phase.
+    if (waiting.load(std::memory_order_acquire) != 0)
+        std::lock_guard wait(gate);
+    shared.lock_shared();
+}
+
+bool IniHandler::statFile(fileStamp& out) const
+{
+#ifdef _WIN32
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+
+    out = {};
+    out.size = size;
+    out.modified = modified.time_since_epoch().count();
+    return true;
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return false;
+
+    out.device = static_cast<std::uint64_t>(st.st_dev);
+    out.inode = static_cast<std::uint64_t>(st.st_ino);
+    out.size = static_cast<std::uint64_t>(st.st_size);
+#ifdef __APPLE__
+    out.modified = std::int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+    out.changed = std::int64_t(st.st_ctimespec.tv_sec) * 1000000000 + st.st_ctimespec.tv_nsec;
+#else
+    out.modified = std::int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    out.changed = std::int64_t(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+    return true;
+#endif
+}
+
+void IniHandler::scanChunk(std::string_view text, std::size_t begin, std::size_t end, parsedChunk& out)
+{
+    sectionView* currentSection = nullptr;
+
+    IniScanner scanner(text.substr(begin, end - begin));
+    IniScanner::iniLine lines[256];
+    while (std::size_t count = scanner.next(lines, std::size(lines)))
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            IniScanner::iniLine line = lines[i];
+            line.begin += begin;
+            line.end += begin;
+            line.next += begin;
+            line.delimiter += begin;
+
+            if (line.kind == IniScanner::lineKind::section)
+            {
+                out.sections.push_back({ text.substr(line.begin + 1, line.end - line.begin - 2), entryList(out.memory), line.begin, line.next });
+                currentSection = &out.sections.back();
+            }
+            else if (line.kind == IniScanner::lineKind::entry)
+            {
+                entryView entry{
+                    text.substr(line.begin, line.delimiter - line.begin),
+                    text.substr(line.delimiter + 1, line.end - line.delimiter - 1),
+                    nullptr,
+                    line.begin };
+                if (currentSection)
+                {
+                    currentSection->entries.push_back(std::move(entry));
+                    currentSection->end = line.next;
+                }
+                else
+                {
+                    out.leading.push_back(std::move(entry));
+                    out.leadingEnd = line.next;
+                }
+            }
+        }
+    }
+}
+
+void IniHandler::buildIndex(unsigned threads)
+{
+    // Each worker numbers the names of its own run of sections in a table on its arena. The
+    // tables are then merged into parsed.ids serially, which hashes each run's distinct names
+    // only, and the section map is filled; last, each worker renumbers its entries and builds
+    // their key maps, which come from its own arena.
+    parsed.index.clear();
+    parsed.index.reserve(parsed.sections.size());
+    if (parsed.arenaCount != 0)
+        threads = std::min<unsigned>(threads, static_cast<unsigned>(parsed.arenaCount));
+    std::size_t workers = std::max<std::size_t>(1, std::min<std::size_t>(threads, parsed.sections.size() / 64));
+    auto first = [&](std::size_t worker) { return worker * parsed.sections.size() / workers; };
+
+    std::vector<std::pmr::vector<std::string_view>> local;
+    local.reserve(workers);
+    for (std::size_t worker = 0; worker < workers; ++worker)
+        local.emplace_back(memoryFor(worker));
+    runParallel(workers, [&](std::size_t worker) {
+        std::pmr::unordered_map<std::string_view, nameId> ids(memoryFor(worker));
+        auto number = [&](std::string_view name) {
+            auto [it, inserted] = ids.try_emplace(name, static_cast<nameId>(local[worker].size()));
+            if (inserted)
+                local[worker].push_back(name);
+            return it->second;
+        };
+        for (std::size_t i = first(worker); i < first(worker + 1); ++i)
+        {
+            sectionView& section = parsed.sections[i];
+            section.id = number(section.name);
+            for (entryView& e : section.entries)
+                e.id = number(e.name);
+        }
+    });
+
+    std::vector<std::vector<nameId>> global(workers);
+    std::vector<std::vector<sectionIndex*>> fresh(workers);
+    for (std::size_t worker = 0; worker < workers; ++worker)
+    {
+        global[worker].reserve(local[worker].size());
+        for (std::string_view name : local[worker])
+            global[worker].push_back(intern(name));
+
+        for (std::size_t i = first(worker); i < first(worker + 1); ++i)
+        {
+            sectionView& section = parsed.sections[i];
+            section.id = global[worker][section.id];
+            auto [it, inserted] = parsed.index.try_emplace(section.id, memoryFor(worker));
+            if (!inserted)
+                continue;
+            it->second.position = i;
+            fresh[worker].push_back(&it->second);
+        }
+    }
+
+    runParallel(workers, [&](std::size_t worker) {
+        for (std::size_t i = first(worker); i < first(worker + 1); ++i)
+            for (entryView& e : parsed.sections[i].entries)
+                e.id = global[worker][e.id];
+        for (sectionIndex* index : fresh[worker])
+            indexEntries(*index);
+    });
+}
+
+void IniHandler::indexEntries(sectionIndex& index)
+{
+    const sectionView& section = parsed.sections[index.position];
+    index.entries.reserve(section.entries.size());
+    for (std::size_t i = 0; i < section.entries.size(); ++i)
+        index.entries.emplace(section.entries[i].id, i);
+}
+
+IniHandler::sectionIndex& IniHandler::indexSection(std::size_t position)
+{
+    auto [it, inserted] = parsed.index.try_emplace(parsed.sections[position].id, memoryFor(0));
+    if (!inserted)
+        return it->second;
+
+    it->second.position = position;
+    indexEntries(it->second);
+    return it->second;
+}
+
+IniHandler::sectionIndex* IniHandler::findSection(std::string_view name)
+{
+    return findSection(idOf(name));
+}
+
+IniHandler::sectionIndex* IniHandler::findSection(nameId id)
+{
+    auto it = parsed.index.find(id);
+    return it == parsed.index.end() ? nullptr : &it->second;
+}
+
+IniHandler::entryView* IniHandler::findEntry(std::string_view section, std::string_view key)
+{
+    sectionIndex* s = findSection(section);
+    if (!s)
+        return nullptr;
+
+    auto it = s->entries.find(idOf(key));
+    return it == s->entries.end() ? nullptr : &parsed.sections[s->position].entries[it->second];
+}
+
+void IniHandler::publish()
+{
+    if (lookups != lookupMode::snapshot || !loaded)
+        return;
+    thaw();
+
+    auto next = std::make_unique<snapshot>();
+    next->source = parsed.source;
+    next->stamp = stamp;
+    next->version = ++publishedVersions;
+
+    // Slices of the source stay valid with it; anything written since lives in
+    // parsed.strings, which later writes reuse, so it is copied.
+    std::string_view source = parsed.source ? parsed.source->bytes() : std::string_view();
+    auto inSource = [&](std::string_view text) {
+        return text.empty()
+            || (std::less_equal<const char*>()(source.data(), text.data())
+                && std::less_equal<const char*>()(text.data() + text.size(), source.data() + source.size()));
+    };
+
+    std::size_t copied = 0;
+    for (const auto& [id, section] : parsed.index)
+    {
+        copied += inSource(parsed.names[id]) ? 0 : parsed.names[id].size();
+        for (const auto& [key, position] : section.entries)
+        {
+            const entryView& e = parsed.sections[section.position].entries[position];
+            copied += (inSource(e.name) ? 0 : e.name.size()) + (inSource(e.value) ? 0 : e.value.size());
+        }
+    }
+
+    // Reserved up front, so the views taken below are never moved by a reallocation.
+    next->arena.reserve(copied);
+    auto hold = [&](std::string_view text) {
+        if (inSource(text))
+            return text;
+        std::size_t at = next->arena.size();
+        next->arena.append(text);
+        return std::string_view(next->arena).substr(at, text.size());
+    };
+
+    next->sections.reserve(parsed.index.size());
+    for (const auto& [id, section] : parsed.index)
+    {
+        auto& entries = next->sections[hold(parsed.names[id])];
+        entries.reserve(section.entries.size());
+        for (const auto& [key, position] : section.entries)
+        {
+            const entryView& e = parsed.sections[section.position].entries[position];
+            entries[hold(e.name)].text = hold(e.value);
+        }
+    }
+
+    if (const snapshot* old = published.exchange(next.release(), std::memory_order_acq_rel))
+        retiredSnapshots.retire(const_cast<snapshot*>(old), [](void* p) { delete static_cast<snapshot*>(p); });
+}
+
+void IniHandler::unpublish()
+{
+    if (const snapshot* old = published.exchange(nullptr, std::memory_order_acq_rel))
+        retiredSnapshots.retire(const_cast<snapshot*>(old), [](void* p) { delete static_cast<snapshot*>(p); });
+}
+
+const IniHandler::snapshot* IniHandler::freshSnapshot() const
+{
+    const snapshot* snap = published.load(std::memory_order_acquire);
+    if (!snap || policy.load(std::memory_order_relaxed) == reloadPolicy::never || watching.load(std::memory_order_relaxed))
+        return snap;
+
+    fileStamp now;
+    return statFile(now) && now == snap->stamp ? snap : nullptr;
+}
+
+const IniHandler::snapshotValue* IniHandler::snapshot::find(std::string_view section, std::string_view key) const
+{
+    auto s = sections.find(section);
+    if (s == sections.end())
+        return nullptr;
+
+    auto e = s->second.find(key);
+    return e == s->second.end() ? nullptr : &e->second;
+}
+
+IniHandler::nameId IniHandler::idOf(std::string_view name) const
+{
+    auto it = parsed.ids.find(name);
+    return it == parsed.ids.end() ? noName : it->second;
+}
+
+IniHandler::nameId IniHandler::intern(std::string_view name)
+{
+    auto [it, inserted] = parsed.ids.try_emplace(name, static_cast<nameId>(parsed.names.size()));
+    if (inserted)
+        parsed.names.push_back(name);
+    return it->second;
+}
+
+IniHandler::nameId IniHandler::keep(std::string_view name)
+{
+    if (nameId id = idOf(name); id != noName)
+        return id;
+
+    std::string_view stored;
+    if (parsed.arenaCount == 0)
+        stored = parsed.strings.emplace_back(name);
+    else
+    {
+        char* copy = static_cast<char*>(arenas.front().allocate(name.size(), 1));
+        std::memcpy(copy, name.data(), name.size());
+        stored = { copy, name.size() };
+    }
+    return intern(stored);
+}
+
+void IniHandler::resetModel(unsigned threads, std::size_t bytes)
+{
+    // pmr containers keep their allocator through assignment, so the old model is destroyed
+    // while the arenas behind it still exist, and the new one is constructed on the reset ones.
+    std::destroy_at(&parsed);
+
+    unsigned count = 0;
+    if (storage != storageMode::arena)
+        arenas.clear();
+    else
+    {
+        // Entries and key nodes take a few times the bytes of their lines; the first parse
+        // finds out how many, and later ones start with a first block that fits.
+        while (arenas.size() < threads)
+            arenas.emplace_back();
+        for (unsigned i = 0; i < threads; ++i)
+            arenas[i].reset(std::max<std::size_t>(std::size_t(4) << 10, bytes * 2 / threads));
+        count = threads;
+    }
+
+    std::construct_at(&parsed, count == 0 ? std::pmr::new_delete_resource() : &arenas.front());
+    parsed.arenaCount = count;
+}
+
+std::pmr::memory_resource* IniHandler::memoryFor(std::size_t worker)
+{
+    return parsed.arenaCount == 0 ? std::pmr::new_delete_resource() : &arenas[worker];
+}
+
+void IniHandler::modelArena::reset(std::size_t bytes)
+{
+    blocks.reset();
+    std::size_t needed = std::max(bytes, firstSize + spill.used);
+    if (needed > firstSize)
+    {
+        first.reset(new std::byte[needed]);
+        firstSize = needed;
+    }
+    spill.used = 0;
+    blocks.emplace(first.get(), firstSize, &spill);
+}
+
+void* IniHandler::modelArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    return blocks->allocate(bytes, alignment);
+}
+
+void* IniHandler::modelArena::overflow::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    used += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void IniHandler::modelArena::overflow::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+std::shared_ptr<IniHandler::sourceBuffer> IniHandler::sourceBuffer::open(const std::filesystem::path& path, parseMode mode)
+{
+    auto buffer = std::make_shared<sourceBuffer>();
+
+#ifndef _WIN32
+    if (mode == parseMode::mapped)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        // mmap() rejects zero-length mappings; an empty file simply has no bytes.
+        if (st.st_size > 0)
+        {
+            void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ::close(fd);
+                return nullptr;
+            }
+            buffer->data = static_cast<const char*>(addr);
+            buffer->size = static_cast<std::size_t>(st.st_size);
+            buffer->mapped = true;
+        }
+        ::close(fd);
+        return buffer;
+    }
+#else
+    (void)mode;
+#endif
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+        return nullptr;
+
+    std::streamoff length = in.tellg();
+    if (length < 0)
+        return nullptr;
+
+    buffer->copy.resize(static_cast<std::size_t>(length));
+    in.seekg(0);
+    if (length > 0 && !in.read(buffer->copy.data(), length))
+        return nullptr;
+
+    buffer->data = buffer->copy.data();
+    buffer->size = buffer->copy.size();
+    return buffer;
+}
+
+IniHandler::sourceBuffer::~sourceBuffer()
+{
+#ifndef _WIN32
+    if (mapped)
+        ::munmap(const_cast<char*>(data), size);
+#endif
+}
+
+bool IniHandler::writeEntry_str(std::string_view section, std::string_view key, std::string_view value)
+{
+    INIHANDLER_TIME(writeEntry);
+    std::unique_lock lock(mutex);
+    if (!ensureLoaded())
+        return false;
+    thaw();
+
+    if (const entryView* existing = findEntry(section, key); existing && existing->value == value)
+    {
+        ++elided;
+        return true;
+    }
+
+    assignValue(entryFor(section, key), value);
+    return save();
+}
+
+bool IniHandler::writeEntry(const std::string& section, const iniEntry& entry)
+{
+    return writeEntry_str(section, entry.name, entry.value);
+}
+
+bool IniHandler::writeEntry(const std::string& section, iniEntry&& entry)
+{
+    INIHANDLER_TIME(writeEntry);
+    std::unique_lock lock(mutex);
+    if (!ensureLoaded())
+        return false;
+    thaw();
+
+    if (const entryView* existing = findEntry(section, entry.name); existing && existing->value == entry.value)
+    {
+        ++elided;
+        return true;
+    }
+
+    assignValue(entryFor(section, entry.name), std::move(entry.value));
+    return save();
+}
+
+IniHandler::sectionIndex& IniHandler::sectionFor(std::string_view name)
+{
+    nameId id = keep(name);
+    if (sectionIndex* existing = findSection(id))
+        return *existing;
+
+    parsed.sections.push_back({ parsed.names[id], entryList(memoryFor(0)), npos, npos, id });
+    markDirty(parsed.sections.size() - 1, 0);
+    return indexSection(parsed.sections.size() - 1);
+}
+
+IniHandler::entryView& IniHandler::entryFor(std::string_view section, std::string_view key)
+{
+    sectionIndex& target = sectionFor(section);
+    auto& entries = parsed.sections[target.position].entries;
+
+    nameId id = keep(key);
+    auto it = target.entries.find(id);
+    if (it != target.entries.end())
+    {
+        markDirty(target.position, it->second + 1);
+        return entries[it->second];
+    }
+
+    entries.push_back({ parsed.names[id], {}, nullptr, npos, id });
+    target.entries.emplace(id, entries.size() - 1);
+    markDirty(target.position, entries.size());
+    return entries.back();
+}
+
+IniHandler::typedCache& IniHandler::typedCache::operator=(const typedCache& other)
+{
+    if (this != &other)
+        clear();
+    return *this;
+}
+
+IniHandler::typedCache& IniHandler::typedCache::operator=(typedCache&& other) noexcept
+{
+    if (this != &other)
+    {
+        clear();
+        slot.store(other.slot.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+bool IniHandler::typedCache::load(const void* type, void* out, std::size_t size) const
+{
+    const cached* value = slot.load(std::memory_order_acquire);
+    if (!value || value->type != type)
+        return false;
+    std::memcpy(out, value->bytes, size);
+    return true;
+}
+
+void IniHandler::typedCache::store(const void* type, const void* value, std::size_t size) const
+{
+    if (slot.load(std::memory_order_relaxed) || size > capacity)
+        return;
+
+    auto* fresh = new cached{ type, {} };
+    std::memcpy(fresh->bytes, value, size);
+
+    // Another reader may have cached the entry meanwhile; the first one stays.
+    cached* expected = nullptr;
+    if (!slot.compare_exchange_strong(expected, fresh, std::memory_order_release, std::memory_order_relaxed))
+        delete fresh;
+}
+
+void IniHandler::typedCache::clear()
+{
+    delete slot.exchange(nullptr, std::memory_order_relaxed);
+}
+
+void IniHandler::assignValue(entryView& entry, std::string_view value)
+{
+    if (entry.owned)
+        entry.owned->assign(value);
+    else
+        entry.owned = &parsed.strings.emplace_back(value);
+    entry.value = *entry.owned;
+    entry.typed.clear();
+}
+
+void IniHandler::assignValue(entryView& entry, std::string&& value)
+{
+    if (entry.owned)
+        *entry.owned = std::move(value);
+    else
+        entry.owned = &parsed.strings.emplace_back(std::move(value));
+    entry.value = *entry.owned;
+    entry.typed.clear();
+}
+
+
+#ifdef INIHANDLER_STATS
+IniHandler::statistics IniHandler::stats() const
+{
+    auto load = [](const std::atomic<std::uint64_t>& value) { return value.load(std::memory_order_relaxed); };
+
+    statistics snapshot;
+    snapshot.filesOpened = load(counters.filesOpened);
+    snapshot.bytesRead = load(counters.bytesRead);
+    snapshot.parses = load(counters.parses);
+    snapshot.bytesWritten = load(counters.bytesWritten);
+    snapshot.fullRewrites = load(counters.fullRewrites);
+    snapshot.partialRewrites = load(counters.partialRewrites);
+    snapshot.lookupHits = load(counters.lookupHits);
+    snapshot.lookupMisses = load(counters.lookupMisses);
+    snapshot.elidedWrites = load(elided);
+    for (std::size_t op = 0; op < snapshot.latencies.size(); ++op)
+    {
+        const liveLatency& live = counters.latencies[op];
+        latency& l = snapshot.latencies[op];
+        l.count = load(live.count);
+        l.totalNs = load(live.totalNs);
+        for (std::size_t b = 0; b < l.buckets.size(); ++b)
+            l.buckets[b] = load(live.buckets[b]);
+    }
+    return snapshot;
+}
+
+void IniHandler::resetStats()
+{
+    auto clear = [](std::atomic<std::uint64_t>& value) { value.store(0, std::memory_order_relaxed); };
+
+    for (auto* value : { &counters.filesOpened, &counters.bytesRead, &counters.parses, &counters.bytesWritten,
+                         &counters.fullRewrites, &counters.partialRewrites, &counters.lookupHits, &counters.lookupMisses, &elided })
+        clear(*value);
+    for (liveLatency& live : counters.latencies)
+    {
+        clear(live.count);
+        clear(live.totalNs);
+        for (auto& bucket : live.buckets)
+            clear(bucket);
+    }
+}
+
+const char* IniHandler::operationName(operation op)
+{
+    switch (op)
+    {
+    case operation::readEntry: return "readEntry";
+    case operation::readSection: return "readSection";
+    case operation::writeEntry: return "writeEntry";
+    case operation::writeSection: return "writeSection";
+    case operation::commit: return "commit";
+    case operation::reload: return "reload";
+    case operation::count: break;
+    }
+    return "";
+}
+
+bool IniHandler::writeStats(const std::filesystem::path& file) const
+{
+    const statistics s = stats();
+
+    // Label values escape backslash, quote and newline.
+    std::string label;
+    for (char c : path.string())
+    {
+        if (c == '\\' || c == '"')
+            label.push_back('\\');
+        if (c == '\n')
+            label.append("\\n");
+        else
+            label.push_back(c);
+    }
+    const std::string fileLabel = "file=\"" + label + "\"";
+
+    std::ostringstream out;
+    out.precision(12);
+    auto counter = [&](const char* name, const char* help, std::uint64_t value) {
+        out << "# HELP inihandler_" << name << " " << help << "\n"
+            << "# TYPE inihandler_" << name << " counter\n"
+            << "inihandler_" << name << "{" << fileLabel << "} " << value << "\n";
+    };
+    counter("files_opened_total", "Files opened for parsing or saving.", s.filesOpened);
+    counter("bytes_read_total", "Bytes read by parses.", s.bytesRead);
+    counter("parses_total", "Complete parses of the file.", s.parses);
+    counter("bytes_written_total", "Bytes written by saves.", s.bytesWritten);
+    counter("elided_writes_total", "Writes skipped because they would not change the file.", s.elidedWrites);
+
+    out << "# HELP inihandler_rewrites_total Saves by the amount of the file they wrote.\n"
+        << "# TYPE inihandler_rewrites_total counter\n"
+        << "inihandler_rewrites_total{" << fileLabel << ",kind=\"full\"} " << s.fullRewrites << "\n"
+        << "inihandler_rewrites_total{" << fileLabel << ",kind=\"partial\"} " << s.partialRewrites << "\n";
+
+    out << "# HELP inihandler_lookups_total Key and section lookups by outcome.\n"
+        << "# TYPE inihandler_lookups_total counter\n"
+        << "inihandler_lookups_total{" << fileLabel << ",result=\"hit\"} " << s.lookupHits << "\n"
+        << "inihandler_lookups_total{" << fileLabel << ",result=\"miss\"} " << s.lookupMisses << "\n";
+
+    out << "# HELP inihandler_operation_duration_seconds Latency of public operations.\n"
+        << "# TYPE inihandler_operation_duration_seconds histogram\n";
+    for (std::size_t op = 0; op < s.latencies.size(); ++op)
+    {
+        const latency& l = s.latencies[op];
+        const std::string labels = fileLabel + ",op=\"" + operationName(static_cast<operation>(op)) + "\"";
+
+        std::uint64_t cumulative = 0;
+        std::uint64_t bound = latencyFirstBucketNs;
+        for (std::uint64_t bucket : l.buckets)
+        {
+            cumulative += bucket;
+            out << "inihandler_operation_duration_seconds_bucket{" << labels << ",le=\"" << static_cast<double>(bound) / 1e9
+                << "\"} " << cumulative << "\n";
+            bound *= 4;
+        }
+        out << "inihandler_operation_duration_seconds_bucket{" << labels << ",le=\"+Inf\"} " << l.count << "\n"
+            << "inihandler_operation_duration_seconds_sum{" << labels << "} " << static_cast<double>(l.totalNs) / 1e9 << "\n"
+            << "inihandler_operation_duration_seconds_count{" << labels << "} " << l.count << "\n";
+    }
+
+    return replaceFile(file, out.str(), durability::none);
+}
+#endif
@@ -6,13 +6,34 @@
 #pragma once
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <filesystem>
 #include <unordered_map>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <thread>
+#include <optional>
+#include "iniCompiled.h"
+#include "iniEpoch.h"
+#include "iniValue.h"
+#ifdef INIHANDLER_STATS
+#include <array>
+#endif
 
  /// @class IniHandler
  /// @brief Utility class for reading and writing INI style configuration files.
+ ///
+ /// All public members may be called from several threads at once. Reads
+ /// share a lock and run in parallel; writes, reloads and setters take it
+ /// exclusively.
 class IniHandler
 {
 public:
@@ -27,14 +48,17 @@ public:
      */
     explicit IniHandler(const std::filesystem::path& filePath)
     {
-        file.path = filePath;
+        path = filePath;
 
-        if (!std::filesystem::exists(file.path))
+        if (!std::filesystem::exists(path))
         {
-            std::ofstream createFile(file.path);
+            std::ofstream createFile(path);
         }
     }
 
+    /// @brief Stops watching and frees the published snapshot; no lookup may still be running.
+    ~IniHandler();
+
     struct iniEntry {
         std::string name;
         std::string value;
@@ -50,6 +74,435 @@ public:
         std::vector<iniSection> sections;
     };
 
+    /// @brief One section touched by writes, as returned by readChanges().
+    struct iniChange {
+        iniSection section; ///< The written entries with their current values, or every entry when whole is set.
+        bool whole = false; ///< The section was replaced or added; keys missing from it no longer exist.
+    };
+
+    /// @brief Selects how the file is brought into memory for parsing.
+    enum class parseMode {
+        buffered, ///< Read the whole file into one heap buffer (default).
+        mapped    ///< mmap() the file read-only; falls back to buffered where mapping is unavailable.
+    };
+
+    /// @brief Controls when the cached model is checked against the file on disk.
+    enum class reloadPolicy {
+        onChange, ///< stat() the file before each call and re-parse only if it changed (default).
+        never     ///< Parse once and keep serving the cached model until reload() is called.
+    };
+
+    /**
+     * @brief Discards the cached model and parses the file again.
+     *
+     * @return true when the file was read, false otherwise.
+     *
+     * @code
+     * handler.setReloadPolicy(IniHandler::reloadPolicy::never);
+     * // ... file edited by another process ...
+     * handler.reload();
+     * @endcode
+     */
+    bool reload();
+
+    /**
+     * @brief Selects how the cached model is validated before each call.
+     *
+     * @param mode reloadPolicy::onChange or reloadPolicy::never.
+     */
+    void setReloadPolicy(reloadPolicy mode)
+    {
+        std::unique_lock lock(mutex);
+        policy = mode;
+    }
+
+    /**
+     * @brief Re-parses the file in the background whenever it changes on disk.
+     *
+     * Watches the file's directory with inotify, so editors that save by
+     * writing a new file and renaming it over the old one are followed too.
+     * While watching, lookups no longer stat() the file: the model is
+     * re-parsed on a background thread only when a change notification
+     * arrives and the file's identity actually differs, then published and
+     * announced to subscribe()d callbacks. Changes are not picked up while
+     * a batch is open.
+     *
+     * Because that re-parse can happen at any moment, a view returned by
+     * readEntry_view() may dangle as soon as it is returned, even when only
+     * one thread uses the handler. Use readEntry() or get() while watching.
+     *
+     * @return true when watching (or already watching), false if the
+     *         directory cannot be watched or the platform has no inotify.
+     *
+     * @code
+     * handler.subscribe([&] { applyConfig(handler); });
+     * handler.watch();
+     * @endcode
+     */
+    bool watch();
+
+    /// @brief Stops watch()ing; lookups stat() the file again. Must not be called from a change callback.
+    void unwatch();
+
+    /**
+     * @brief Registers a callback run after the watcher re-parsed a changed file.
+     *
+     * Callbacks run on the watcher thread, without any lock held, and may
+     * call back into the handler.
+     *
+     * @param callback Function to run after each background reload.
+     * @return Id to pass to unsubscribe().
+     */
+    std::size_t subscribe(std::function<void()> callback);
+
+    /// @brief Removes a callback registered with subscribe().
+    void unsubscribe(std::size_t id);
+
+    /**
+     * @brief Selects how the next parse reads the file.
+     *
+     * Either way sections and entries are kept as slices of the file
+     * contents; strings are only copied when they are written. In mapped
+     * mode the file must not be truncated by another process while the
+     * handler holds the mapping.
+     *
+     * @param mode parseMode::buffered or parseMode::mapped.
+     *
+     * @code
+     * handler.setParseMode(IniHandler::parseMode::mapped);
+     * handler.reload();
+     * @endcode
+     */
+    void setParseMode(parseMode mode)
+    {
+        std::unique_lock lock(mutex);
+        readMode = mode;
+    }
+
+    /**
+     * @brief Sets how many threads a parse may use.
+     *
+     * Files of at least parallelChunkBytes per extra thread are split at
+     * line boundaries into one slice per thread, scanned concurrently and
+     * stitched back in file order; a section whose entries run across a
+     * slice boundary is joined again, so the model is the same as after a
+     * serial parse. The per-section key indexes are then built in parallel
+     * as well. Smaller files are parsed on the calling thread.
+     *
+     * @param threads Upper bound on parse threads, including the caller; 0 and 1 parse serially (default).
+     *
+     * @code
+     * handler.setParseThreads(std::thread::hardware_concurrency());
+     * handler.reload();
+     * @endcode
+     */
+    void setParseThreads(unsigned threads)
+    {
+        std::unique_lock lock(mutex);
+        parseThreads = threads == 0 ? 1 : threads;
+    }
+
+    /// Smallest slice of the file worth handing to another parse thread.
+    static constexpr std::size_t parallelChunkBytes = std::size_t(256) << 10;
+
+    /// @brief Selects where the model's per-section entry lists, key indexes and names are allocated.
+    enum class storageMode {
+        heap, ///< One heap allocation per index node, entry list and written name (default).
+        arena ///< A few large blocks per parse thread, reused by the next parse and freed with the handler.
+    };
+
+    /**
+     * @brief Selects how the next parse stores its model.
+     *
+     * Values are slices of the file contents either way. In arena mode the
+     * entry lists, index nodes and stored names of a parse are carved from
+     * one block per parse thread, so a file with 100k keys costs a handful of
+     * allocations instead of 100k, lookups walk memory laid out in file
+     * order, and dropping the model frees nothing node by node. The block
+     * is kept and reused by the next parse, grown to what the last one
+     * needed. Section and key names are interned in both modes: each
+     * distinct name gets a small ID that the index is keyed by, so a lookup
+     * hashes the caller's strings once and then compares IDs, and a name a
+     * write stores is copied once however many writes use it.
+     *
+     * Memory an arena hands out is only reclaimed by the next parse, so
+     * writes that add keys or rename the keys of a section grow it until
+     * then; writes that only change values do not.
+     *
+     * @param mode storageMode::heap or storageMode::arena.
+     *
+     * @code
+     * handler.setStorageMode(IniHandler::storageMode::arena);
+     * handler.reload();
+     * @endcode
+     */
+    void setStorageMode(storageMode mode)
+    {
+        std::unique_lock lock(mutex);
+        storage = mode;
+    }
+
+    /// @brief How far a save is flushed before it is considered complete.
+    enum class durability {
+        none,            ///< Rename the new file into place without syncing (default).
+        data,            ///< fdatasync() the new file before renaming it into place.
+        dataAndDirectory ///< Additionally fsync() the directory so the rename itself survives a crash.
+    };
+
+    /**
+     * @brief Selects the durability of saves.
+     *
+     * Every save writes a sibling temp file and renames it over the
+     * original, so readers never see a partially written file. The level
+     * only decides what is synced to stable storage along the way.
+     *
+     * @param level durability::none, durability::data or durability::dataAndDirectory.
+     *
+     * @code
+     * handler.setDurability(IniHandler::durability::data);
+     * @endcode
+     */
+    void setDurability(durability level)
+    {
+        std::unique_lock lock(mutex);
+        syncLevel = level;
+    }
+
+    /// @brief How a save replaces the file on disk.
+    enum class saveMode {
+        atomic,     ///< Always write a complete new file and rename it into place (default).
+        append,     ///< Append new keys and sections with O_APPEND; anything else is saved atomically.
+        incremental ///< Append where possible, otherwise rewrite the file in place from the first change.
+    };
+
+    /**
+     * @brief Selects how saves reach the disk.
+     *
+     * The handler remembers where each section and entry starts in the file.
+     * When a save only adds keys to the last section or adds new sections,
+     * append and incremental mode write just those lines to the end of the
+     * file. Incremental mode additionally rewrites other changes in place
+     * from the earliest one onwards (pwrite() plus ftruncate()), so updating
+     * a key near the end of a large file costs only the tail.
+     *
+     * Other readers can observe a half-written file in either mode, so only
+     * use them where that is acceptable. The handler falls back to an atomic
+     * rewrite when the file changed on disk since it was last read or
+     * written, or when an in-place rewrite would touch a mapped source.
+     *
+     * A full rewrite writes only sections and entries, so comments, blank
+     * lines and entries before the first header are dropped. Appends and
+     * in-place rewrites leave the file before the first change untouched,
+     * so those lines survive them and are only lost at the next full
+     * rewrite. The sections and entries on disk are the same either way.
+     *
+     * @param mode saveMode::atomic, saveMode::append or saveMode::incremental.
+     */
+    void setSaveMode(saveMode mode)
+    {
+        std::unique_lock lock(mutex);
+        writeMode = mode;
+    }
+
+    /// @brief Where lookups read the model from.
+    enum class lookupMode {
+        locked,  ///< Take the shared lock and read the live model (default).
+        snapshot ///< Read an immutable copy published after every parse and save, without locks.
+    };
+
+    /**
+     * @brief Selects how readEntry, readEntry_view and readSection find values.
+     *
+     * In snapshot mode every parse and every completed save publishes an
+     * immutable copy of the index through an atomic pointer. Lookups read it
+     * inside an epoch guard (see IniEpoch), taking no lock and doing no
+     * atomic read-modify-write; a replaced copy is freed once no lookup can
+     * still see it. Only when the file changed on disk does a lookup fall
+     * back to the lock and re-parse.
+     *
+     * Publishing copies the index on every save, so this suits files that
+     * are read far more often than written. Lookups see saved state: writes
+     * made inside an open batch become visible at commit().
+     *
+     * @param mode lookupMode::locked or lookupMode::snapshot.
+     *
+     * @code
+     * handler.setLookupMode(IniHandler::lookupMode::snapshot);
+     * // request threads:
+     * std::string timeout = handler.readEntry("Server", { "TimeoutMs", "" });
+     * @endcode
+     */
+    void setLookupMode(lookupMode mode);
+
+    /**
+     * @brief Loads the file from a compiled sidecar when one is up to date.
+     *
+     * The sidecar sits next to the file with a "c" appended to its name
+     * (config.ini -> config.inic) and holds the section directory and hash
+     * index of a previous parse (see IniCompiled). While enabled, a parse
+     * first maps the sidecar and checks that the file's size, modification
+     * time and content hash still match; if so it serves lookups from the
+     * sidecar's index instead of scanning the file and building one. If not,
+     * it parses as usual and writes a fresh sidecar for the next open.
+     *
+     * The first write, or switching to snapshot lookups, turns the loaded
+     * index into the regular model. Saves do not update the sidecar; call
+     * compile() after them if the next open should still skip the parse.
+     *
+     * @param enabled true to use and maintain the sidecar.
+     *
+     * @code
+     * handler.setCompiledCache(true);
+     * handler.reload(); // parses once, then later opens map config.inic
+     * @endcode
+     */
+    void setCompiledCache(bool enabled)
+    {
+        std::unique_lock lock(mutex);
+        useCompiled = enabled;
+    }
+
+    /**
+     * @brief Writes the compiled sidecar for the file as it is on disk now.
+     *
+     * @return true when written (or already loaded from an up-to-date one),
+     *         false on failure or while a batch holds unsaved changes.
+     */
+    bool compile();
+
+    /**
+     * @brief Starts a batch of writes that are flushed to disk once, by commit().
+     *
+     * Until then writeEntry/writeSection only update the cached model, and
+     * the file is not re-checked for outside changes. Batches nest; only the
+     * outermost commit() writes. A batch belongs to the handler, not to the
+     * thread that opened it: writes from other threads join it.
+     *
+     * @code
+     * handler.begin();
+     * handler.writeEntry_str("Graphics", "VSync", "false");
+     * handler.writeEntry_str("Graphics", "Fullscreen", "true");
+     * handler.commit();
+     * @endcode
+     */
+    void begin()
+    {
+        std::unique_lock lock(mutex);
+        ++batchDepth;
+    }
+
+    /**
+     * @brief Ends a batch started with begin(), writing the file if anything changed.
+     *
+     * @return true when successful or still nested, false on file failure or without begin().
+     */
+    bool commit();
+
+    /**
+     * @brief Abandons all open batches and re-reads the file, discarding their changes.
+     *
+     * @return true when the file was read again, false otherwise.
+     */
+    bool rollback();
+
+    /**
+     * @brief Number of write calls skipped because they would not change the file.
+     *
+     * A writeEntry that sets a key to its current value, or a writeSection
+     * that matches the existing section, returns true without touching disk.
+     */
+    std::uint64_t elidedWrites() const { return elided.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Counter that moves whenever the model may have changed.
+     *
+     * Every parse and every write that changes a value bumps it, so a
+     * caller that copied data out of the handler can tell cheaply whether
+     * the copy is still current. See also refresh().
+     */
+    std::uint64_t generation() const { return changes.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Re-parses the file now if the reload policy says it is out of date.
+     *
+     * Lookups do this check themselves; refresh() is for callers that only
+     * watch generation() and would otherwise not notice a change on disk.
+     *
+     * @return true when the model is loaded and current, false if the file cannot be read.
+     */
+    bool refresh();
+
+#ifdef INIHANDLER_STATS
+    /// @brief Public operations whose latency is recorded.
+    enum class operation {
+        readEntry,    ///< readEntry_view() and everything that forwards to it.
+        readSection,
+        writeEntry,   ///< writeEntry_str() and both writeEntry() overloads.
+        writeSection,
+        commit,
+        reload,
+        count
+    };
+
+    /// Upper bound of the first latency bucket; each following bucket is four times wider.
+    static constexpr std::uint64_t latencyFirstBucketNs = 256;
+    static constexpr std::size_t latencyBuckets = 12;
+
+    /// @brief Latency of one operation; calls slower than the last bucket only show up in count.
+    struct latency {
+        std::uint64_t count = 0;
+        std::uint64_t totalNs = 0;
+        std::array<std::uint64_t, latencyBuckets> buckets{}; ///< Calls that took at most 256ns * 4^i and more than the previous bound.
+    };
+
+    /// @brief Snapshot of the counters; only compiled in with INIHANDLER_STATS.
+    struct statistics {
+        std::uint64_t filesOpened = 0;     ///< Opens for parsing and for saving.
+        std::uint64_t bytesRead = 0;
+        std::uint64_t parses = 0;
+        std::uint64_t bytesWritten = 0;
+        std::uint64_t fullRewrites = 0;    ///< Saves that wrote a complete new file.
+        std::uint64_t partialRewrites = 0; ///< Saves that appended or rewrote only the tail of the file.
+        std::uint64_t lookupHits = 0;
+        std::uint64_t lookupMisses = 0;
+        std::uint64_t elidedWrites = 0;
+        std::array<latency, static_cast<std::size_t>(operation::count)> latencies{};
+    };
+
+    /**
+     * @brief Returns the counters collected since construction or the last resetStats().
+     *
+     * Only available when built with INIHANDLER_STATS; otherwise the
+     * counters are compiled out and cost nothing.
+     *
+     * @code
+     * auto s = handler.stats();
+     * std::cout << s.lookupHits << " hits, " << s.parses << " parses" << std::endl;
+     * @endcode
+     */
+    statistics stats() const;
+
+    /// @brief Zeroes all counters, including elidedWrites(); not atomic with respect to concurrent calls.
+    void resetStats();
+
+    /**
+     * @brief Writes the counters to a file in the Prometheus text exposition format.
+     *
+     * The file is replaced atomically, so it can be served by a textfile collector.
+     *
+     * @param file Output path.
+     * @return true when the file was written, false otherwise.
+     *
+     * @code
+     * handler.writeStats("/var/lib/node_exporter/textfile/config.prom");
+     * @endcode
+     */
+    bool writeStats(const std::filesystem::path& file) const;
+
+    /// @brief Name of an operation as used in the Prometheus output.
+    static const char* operationName(operation op);
+#endif
+
     /**
      * @brief Writes a full section and its entries.
      *
@@ -70,6 +523,9 @@ public:
      */
     bool writeSection(const iniSection& section);
 
+    /// @brief Same as writeSection(const iniSection&), moving the values into the cached model.
+    bool writeSection(iniSection&& section);
+
     /**
      * @brief Checks if a section exists and contains entries.
      *
@@ -87,6 +543,46 @@ public:
      */
     bool readSection(const iniSection& section);
 
+    /**
+     * @brief Copies every section and entry in file order.
+     *
+     * Duplicate sections and keys are kept where they occur, unlike the
+     * lookups, which see only the first of each. Writes made in an open
+     * batch are included.
+     *
+     * @return The contents, with no sections if the file cannot be read.
+     *
+     * @code
+     * for (const auto& section : handler.readFile().sections)
+     *     std::cout << section.name << ": " << section.entries.size() << " keys\n";
+     * @endcode
+     */
+    iniFile readFile();
+
+    /**
+     * @brief Copies what writes changed since an earlier generation().
+     *
+     * Lets a caller that keeps a copy of the contents catch up in time
+     * proportional to the writes rather than to the file. A written key is
+     * reported with its current value, once however often it was written.
+     *
+     * @param since generation() value the caller's copy reflects.
+     * @param changed Receives one iniChange per touched section, replacing its contents.
+     * @param generation Receives the generation() the changes bring the copy up to.
+     * @return false if the changes are no longer known (the file was parsed
+     *         since, or too many writes were made); readFile() is needed then.
+     *
+     * @code
+     * std::uint64_t seen = handler.generation();
+     * auto copy = handler.readFile();
+     * // ...
+     * std::vector<IniHandler::iniChange> changed;
+     * if (!handler.readChanges(seen, changed, seen))
+     *     copy = handler.readFile();
+     * @endcode
+     */
+    bool readChanges(std::uint64_t since, std::vector<iniChange>& changed, std::uint64_t& generation);
+
     /**
      * @brief Reads a single value from a specific section.
      *
@@ -114,12 +610,177 @@ public:
      * writeEntry_str("Graphics", "VSync", "false");
      * @endcode
      */
-    bool writeEntry_str(const std::string& section, const std::string& key, const std::string& value);
+    bool writeEntry_str(std::string_view section, std::string_view key, std::string_view value);
 
     std::string readEntry(const std::string& section, const iniEntry& entry);
 
+    /**
+     * @brief Looks up a value without allocating.
+     *
+     * The returned view points into the cached model and stays valid until
+     * the next write or reload. Another thread may write at any time, so
+     * code sharing the handler across threads should use readEntry(). While
+     * watch() is on, the watcher may reload at any time, so the view is not
+     * safe to use at all.
+     *
+     * @param section Section name.
+     * @param key Key within the section.
+     * @return View of the value, or an empty view if the key or section does not exist.
+     *
+     * @code
+     * std::string_view vsync = readEntry_view("Graphics", "VSync");
+     * @endcode
+     */
+    std::string_view readEntry_view(std::string_view section, std::string_view key);
+
+    /**
+     * @brief Reads a value converted to T, without temporary strings or exceptions.
+     *
+     * T may be an integer, floating point, bool, std::chrono duration or
+     * enum; see IniValue::parse() for the accepted text. The first
+     * successful conversion of an entry is cached with it, so later reads
+     * of the same entry as the same type skip parsing. Writing the entry or
+     * re-reading the file drops the cached value.
+     *
+     * @param section Section name.
+     * @param key Key within the section.
+     * @return The value, or std::nullopt if the key does not exist or does not parse as T.
+     *
+     * @code
+     * std::optional<int> threads = handler.get<int>("Server", "Threads");
+     * @endcode
+     */
+    template <typename T>
+    std::optional<T> get(std::string_view section, std::string_view key)
+    {
+        T value{};
+        if (!parseEntry(section, key, &parseInto<T>, &value, cacheTag<T>(), sizeof(T)))
+            return std::nullopt;
+        return value;
+    }
+
+    /**
+     * @brief Reads a value converted to T, or returns fallback.
+     *
+     * @code
+     * auto timeout = handler.get("Server", "Timeout", std::chrono::milliseconds(500));
+     * bool vsync = handler.get("Graphics", "VSync", true);
+     * @endcode
+     */
+    template <typename T>
+    T get(std::string_view section, std::string_view key, const T& fallback)
+    {
+        T value = fallback;
+        parseEntry(section, key, &parseInto<T>, &value, cacheTag<T>(), sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Writes a typed value, formatted with std::to_chars.
+     *
+     * @return true on successful write, false on file failure.
+     *
+     * @code
+     * handler.set("Server", "Threads", 16);
+     * handler.set("Server", "Timeout", std::chrono::seconds(30)); // "30s"
+     * @endcode
+     */
+    template <typename T>
+    bool set(std::string_view section, std::string_view key, const T& value)
+    {
+        char buffer[IniValue::maxFormatted];
+        return writeEntry_str(section, key, IniValue::format(value, buffer));
+    }
+
+private:
+    struct snapshotValue;
+
+public:
+    /**
+     * @brief A (section, key) pair with its position in the model, returned by resolve().
+     *
+     * read() and get() with a handle load the value straight from the
+     * remembered position. Writes to values keep it valid; a parse or a
+     * writeSection moves the layout generation on, and the next read looks
+     * the names up once more and stores the new position. Because reads
+     * update it in place, each thread should use its own copy.
+     *
+     * In lookupMode::snapshot a handle reads the published snapshot, as
+     * readEntry() does, and remembers the value until a new snapshot is
+     * published. In lookupMode::locked it reads under the shared lock.
+     */
+    class keyHandle {
+    public:
+        keyHandle() = default;
+
+        const std::string& section() const { return sectionName; }
+        const std::string& key() const { return keyName; }
+
+    private:
+        friend class IniHandler;
+
+        std::string sectionName;
+        std::string keyName;
+        const IniHandler* owner = nullptr;
+        std::size_t sectionPosition = static_cast<std::size_t>(-1); ///< In parsed.sections, or npos while the key is missing.
+        std::size_t entryPosition = static_cast<std::size_t>(-1);
+        std::uint64_t layout = 0; ///< layoutGeneration when the positions were taken.
+        const snapshotValue* value = nullptr; ///< The key in the snapshot published as version, or nullptr while it is missing.
+        std::uint64_t version = 0;            ///< snapshot::version value was found in; 0 for none.
+    };
+
+    /**
+     * @brief Looks a key up once for repeated reads through read() or get().
+     *
+     * A key that does not exist yet can be resolved too; reads then look
+     * for it each time until it appears.
+     *
+     * @code
+     * auto threads = handler.resolve("Server", "Threads");
+     * for (;;)
+     *     pool.resize(handler.get<int>(threads).value_or(4));
+     * @endcode
+     */
+    keyHandle resolve(std::string_view section, std::string_view key);
+
+    /**
+     * @brief Reads the value a handle refers to.
+     *
+     * @return The value, or an empty string if the key does not exist.
+     */
+    std::string read(keyHandle& handle);
+
+    /**
+     * @brief Reads and converts the value a handle refers to, as get(section, key) does.
+     *
+     * Together with the per-entry conversion cache, a repeated read costs a
+     * generation check, an indexed load and a copy of the cached value, plus
+     * the shared lock in lookupMode::locked. Unless the handler is watch()ing
+     * or uses reloadPolicy::never, each read also stat()s the file.
+     */
+    template <typename T>
+    std::optional<T> get(keyHandle& handle)
+    {
+        T value{};
+        if (!parseHandle(handle, &parseInto<T>, &value, cacheTag<T>(), sizeof(T)))
+            return std::nullopt;
+        return value;
+    }
+
+    /// @brief Reads the value a handle refers to converted to T, or returns fallback.
+    template <typename T>
+    T get(keyHandle& handle, const T& fallback)
+    {
+        T value = fallback;
+        parseHandle(handle, &parseInto<T>, &value, cacheTag<T>(), sizeof(T));
+        return value;
+    }
+
     bool writeEntry(const std::string& section, const iniEntry& entry);
 
+    /// @brief Same as writeEntry(const std::string&, const iniEntry&), moving the value into the cached model.
+    bool writeEntry(const std::string& section, iniEntry&& entry);
+
     /**
      * @brief Checks whether the INI file exists and contains data.
      *
@@ -132,15 +793,448 @@ public:
      */
     bool empty() const
     {
-        if (!std::filesystem::exists(file.path))
+        if (!std::filesystem::exists(path))
             return true;
 
-        std::ifstream in(file.path, std::ios::ate);
+        std::ifstream in(path, std::ios::ate);
         return in.tellg() == 0;
     }
 private:
-    iniFile file;
+    /// std::shared_mutex that lets a waiting writer in ahead of new readers.
+    ///
+    /// glibc's rwlock prefers readers, so a steady stream of overlapping
+    /// lookups could otherwise keep a save waiting forever. Readers only
+    /// touch the gate while a writer is waiting.
+    class rwMutex {
+    public:
+        void lock();
+        void unlock() { shared.unlock(); }
+        void lock_shared();
+        void unlock_shared() { shared.unlock_shared(); }
+
+    private:
+        std::shared_mutex shared;
+        std::mutex gate;                   ///< Held by writers while they wait for the lock.
+        std::atomic<unsigned> waiting = 0; ///< Writers waiting for the lock.
+    };
+
+    /// Identity of the file contents last parsed or written, taken from stat().
+    struct fileStamp {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::uint64_t size = 0;
+        std::int64_t modified = 0;
+        std::int64_t changed = 0;
+
+        bool operator==(const fileStamp&) const = default;
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /// Read-only contents of the file a parse was taken from, mapped or copied into memory.
+    class sourceBuffer {
+    public:
+        sourceBuffer() = default;
+        sourceBuffer(const sourceBuffer&) = delete;
+        sourceBuffer& operator=(const sourceBuffer&) = delete;
+        ~sourceBuffer();
+
+        /// Maps or reads the whole file, or returns nullptr on failure.
+        static std::shared_ptr<sourceBuffer> open(const std::filesystem::path& path, parseMode mode);
+
+        std::string_view bytes() const { return { data, size }; }
+        bool isMapped() const { return mapped; }
+
+    private:
+        const char* data = nullptr;
+        std::size_t size = 0;
+        bool mapped = false;
+        std::string copy;
+    };
+
+    /// Monotonic memory for one parse thread's part of the model in storageMode::arena.
+    ///
+    /// Everything is carved from a first block that is kept from one parse
+    /// to the next, so a re-parse touches memory that is already mapped;
+    /// when a parse outgrows it, the extra blocks come from the heap and the
+    /// first block is enlarged to match before the next parse.
+    class modelArena : public std::pmr::memory_resource {
+    public:
+        modelArena() = default;
+        modelArena(const modelArena&) = delete;
+        modelArena& operator=(const modelArena&) = delete;
+
+        /// Forgets everything handed out and makes room for at least bytes; nothing allocated from it may be left.
+        void reset(std::size_t bytes);
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        /// Upstream of blocks once the first block is used up; counts what it hands out.
+        class overflow : public std::pmr::memory_resource {
+        public:
+            std::size_t used = 0;
+
+        private:
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+            void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        };
+
+        std::unique_ptr<std::byte[]> first;
+        std::size_t firstSize = 0;
+        overflow spill;
+        std::optional<std::pmr::monotonic_buffer_resource> blocks; ///< Declared last, so its blocks go back to spill first.
+    };
+
+    /// Converted copy of a value, filled by the first successful get<T>.
+    ///
+    /// Lookups fill it while sharing the lock, so the value is published
+    /// through an atomic pointer and never changed once set. Copies start
+    /// empty and moves transfer it; both only happen under the exclusive lock.
+    class typedCache {
+    public:
+        static constexpr std::size_t capacity = 16;
+
+        typedCache() = default;
+        typedCache(const typedCache&) {}
+        typedCache(typedCache&& other) noexcept : slot(other.slot.exchange(nullptr, std::memory_order_relaxed)) {}
+        typedCache& operator=(const typedCache& other);
+        typedCache& operator=(typedCache&& other) noexcept;
+        ~typedCache() { clear(); }
+
+        /// Copies the cached value into out if it was cached as this type.
+        bool load(const void* type, void* out, std::size_t size) const;
+
+        /// Caches a value unless another one is cached already.
+        void store(const void* type, const void* value, std::size_t size) const;
+
+        /// Drops the cached value; needs the exclusive lock.
+        void clear();
+
+    private:
+        struct cached {
+            const void* type;
+            unsigned char bytes[capacity];
+        };
+
+        mutable std::atomic<cached*> slot = nullptr;
+    };
+
+    /// Identifies T in a typedCache, or nullptr for types that are not cached.
+    template <typename T>
+    static const void* cacheTag()
+    {
+        static constexpr char tag = 0;
+        if constexpr (sizeof(T) <= typedCache::capacity && std::is_trivially_copyable_v<T>)
+            return &tag;
+        else
+            return nullptr;
+    }
+
+    /// Position of an interned section or key name in parsedFile::names.
+    using nameId = std::uint32_t;
+    static constexpr nameId noName = ~nameId(0);
+
+    /// An entry whose name and value point into the source buffer or into parsedFile::strings.
+    struct entryView {
+        std::string_view name;
+        std::string_view value;
+        std::string* owned = nullptr; ///< String in parsedFile::strings holding the value once written; reused by later writes.
+        std::size_t offset = npos;    ///< File offset of the entry's line, or npos if it is not on disk yet.
+        nameId id = noName;           ///< Interned name; noName until the model is indexed.
+        typedCache typed{};
+    };
+
+    /// Entries of a section, allocated from the arena of the thread that parsed it, or the heap.
+    using entryList = std::pmr::vector<entryView>;
+
+    struct sectionView {
+        std::string_view name;
+        entryList entries;
+        std::size_t offset = npos; ///< File offset of the header line, or npos if it is not on disk yet.
+        std::size_t end = npos;    ///< File offset just past the section's last header or entry line.
+        nameId id = noName;        ///< Interned name; noName until the model is indexed.
+    };
+
+    template <typename T>
+    using nameMap = std::unordered_map<std::string_view, T>;
+
+    /// Map from interned names whose nodes come from the model's arena, or the heap.
+    template <typename T>
+    using modelMap = std::pmr::unordered_map<nameId, T>;
+
+    /// Position of a section in parsedFile::sections and of each of its keys in entries.
+    struct sectionIndex {
+        explicit sectionIndex(std::pmr::memory_resource* memory) : entries(memory) {}
+
+        std::size_t position = 0;
+        modelMap<std::size_t> entries;
+    };
+
+    /// The resident model: slices of the source plus the strings written since it was parsed.
+    struct parsedFile {
+        parsedFile() = default;
+
+        /// Index and names allocate from memory, which must outlive the model.
+        explicit parsedFile(std::pmr::memory_resource* memory) : names(memory), ids(memory), index(memory) {}
+
+        std::shared_ptr<const sourceBuffer> source;
+        std::deque<std::string> strings;                        ///< Written values (see entryView::owned), and in heap mode stored names.
+        std::pmr::vector<std::string_view> names;               ///< Interned names by ID; see intern() and keep().
+        std::pmr::unordered_map<std::string_view, nameId> ids;  ///< ID of each interned name.
+        std::size_t arenaCount = 0;                       ///< Leading arenas this model allocates from; 0 in heap mode.
+        std::vector<sectionView> sections;
+        modelMap<sectionIndex> index;
+        bool dirty = false;              ///< Some section or entry differs from the file.
+        std::size_t dirtySection = npos; ///< Earliest changed section.
+        std::size_t dirtyLine = 0;       ///< Earliest changed line within it: 0 is the header, i + 1 is entry i.
+        std::size_t size = 0;            ///< Size of the file as last read or written.
+        bool terminated = true;          ///< The file is empty or ends with '\n'.
+        std::shared_ptr<const sourceBuffer> image; ///< Mapped sidecar; while set, sections and index are empty and compiled answers lookups.
+        IniCompiled compiled;
+    };
+
+    std::filesystem::path path;
+    std::deque<modelArena> arenas; ///< One per parse thread in arena mode, kept across parses; declared before parsed so they outlive it.
+    parsedFile parsed;
+    fileStamp stamp;
+    bool loaded = false;
+    std::atomic<reloadPolicy> policy = reloadPolicy::onChange; ///< Atomic so that snapshot lookups can read it without the lock.
+    parseMode readMode = parseMode::buffered;
+    unsigned parseThreads = 1;
+    durability syncLevel = durability::none;
+    saveMode writeMode = saveMode::atomic;
+    bool useCompiled = false;
+    storageMode storage = storageMode::heap;
+    std::size_t batchDepth = 0;
+    std::atomic<std::uint64_t> elided = 0;
+    std::atomic<std::uint64_t> changes = 0; ///< See generation(); only bumped under the exclusive lock.
+    std::uint64_t layoutGeneration = 1;     ///< Bumped whenever sections or entries may move or be renamed; see keyHandle.
+
+    /// A markDirty() call remembered for readChanges().
+    struct changeRecord {
+        std::uint64_t generation; ///< changes after the write.
+        std::size_t section;      ///< Position in parsed.sections.
+        std::size_t line;         ///< As passed to markDirty(): 0 for the whole section, n for entry n - 1.
+    };
+
+    /// Writes since the last parse, oldest first; cleared when it reaches maxChangeLog.
+    std::vector<changeRecord> changeLog;
+    std::uint64_t changeLogStart = 0; ///< Earliest generation changeLog covers every write since.
+    static constexpr std::size_t maxChangeLog = 4096;
+    mutable rwMutex mutex; ///< Shared by lookups, exclusive for anything that changes the model or settings.
+
+    /// A value in a snapshot; only its typed cache is ever filled in after publishing.
+    struct snapshotValue {
+        std::string_view text;
+        typedCache typed;
+    };
+
+    /// Immutable copy of the index for snapshot lookups; text not in the source is copied into arena.
+    struct snapshot {
+        std::shared_ptr<const sourceBuffer> source;
+        std::string arena;
+        nameMap<nameMap<snapshotValue>> sections;
+        fileStamp stamp; ///< File identity the copy was taken from.
+        std::uint64_t version = 0; ///< Never reused within a handler, unlike the address; see keyHandle.
+
+        /// Returns the value of a key, or nullptr.
+        const snapshotValue* find(std::string_view section, std::string_view key) const;
+    };
+
+    std::atomic<bool> watching = false; ///< watch() is active, so lookups skip the stat() check.
+    std::thread watcher;
+    int watchStop = -1; ///< eventfd that wakes the watcher thread to exit.
+    std::mutex subscribersMutex;
+    std::vector<std::pair<std::size_t, std::function<void()>>> subscribers;
+    std::size_t nextSubscriber = 1;
+
+    lookupMode lookups = lookupMode::locked;
+    std::atomic<const snapshot*> published = nullptr; ///< Only set in snapshot mode once the file was read.
+    std::uint64_t publishedVersions = 0; ///< Last snapshot::version handed out.
+    IniEpoch retiredSnapshots;
+
+#ifdef INIHANDLER_STATS
+    /// latency and statistics as relaxed atomics, so readers holding the shared lock can count.
+    struct liveLatency {
+        std::atomic<std::uint64_t> count = 0;
+        std::atomic<std::uint64_t> totalNs = 0;
+        std::array<std::atomic<std::uint64_t>, latencyBuckets> buckets{};
+    };
+
+    struct liveStatistics {
+        std::atomic<std::uint64_t> filesOpened = 0;
+        std::atomic<std::uint64_t> bytesRead = 0;
+        std::atomic<std::uint64_t> parses = 0;
+        std::atomic<std::uint64_t> bytesWritten = 0;
+        std::atomic<std::uint64_t> fullRewrites = 0;
+        std::atomic<std::uint64_t> partialRewrites = 0;
+        std::atomic<std::uint64_t> lookupHits = 0;
+        std::atomic<std::uint64_t> lookupMisses = 0;
+        std::array<liveLatency, static_cast<std::size_t>(operation::count)> latencies{};
+    };
+
+    liveStatistics counters;
+#endif
 
     /// Internal helper that loads the entire INI file into memory.
     bool readAll();
+
+    /// Internal helper that serializes the cached model back to the file.
+    bool writeAll();
+
+    /// Appends new lines or rewrites the file in place from the earliest dirty line; false if neither is safe.
+    bool writeTail();
+
+    /// Serializes from a section and line (as in parsedFile::dirtyLine) to the end, recording file offsets from base.
+    void emit(std::size_t section, std::size_t line, std::size_t base, std::string& out);
+
+    /// Records a changed line, keeping the earliest one.
+    void markDirty(std::size_t section, std::size_t line);
+
+    /// Marks the model changed and writes it now, or defers it to commit() while a batch is open.
+    bool save();
+
+    /// Forgets the earliest dirty line, once the model has been written out.
+    void markClean();
+
+    /// Parses the file unless the cached model is still current; needs the exclusive lock.
+    bool ensureLoaded();
+
+    /// Builds sections and index from a loaded sidecar so the model can change; needs the exclusive lock.
+    void thaw();
+
+    /// Writes the sidecar for the clean model, whose offsets must describe text.
+    bool writeCompiled(std::string_view text);
+
+    /// Path of the compiled sidecar: the file's path with a "c" appended.
+    std::filesystem::path compiledPath() const;
+
+    /// True when the model is loaded and needs no re-parse; needs at least the shared lock.
+    bool current() const;
+
+    /// Takes the shared lock on a current model, re-parsing under the exclusive lock first if needed.
+    /// The lock is not held when the file cannot be read.
+    std::shared_lock<rwMutex> readLock();
+
+    /// Keeps a value returned by find() alive: the epoch guard for a snapshot value, the shared lock otherwise.
+    struct readPin {
+        std::optional<IniEpoch::guard> epoch;
+        std::shared_lock<rwMutex> lock;
+    };
+
+    /// A value returned by find(); typed is nullptr for a sidecar value, which has no conversion cache.
+    struct foundValue {
+        bool found = false;
+        std::string_view text;
+        const typedCache* typed = nullptr;
+    };
+
+    /// Looks a key up in the published snapshot, then the sidecar, then the locked model, and counts
+    /// the hit or miss; pin keeps the value alive. With a handle for the same key, the model lookup
+    /// goes through locate(). Not found when the file cannot be read.
+    foundValue find(readPin& pin, std::string_view section, std::string_view key, keyHandle* handle = nullptr);
+
+    /// Type-erased IniValue::parse, so the lookup behind get() stays out of the header.
+    template <typename T>
+    static bool parseInto(std::string_view text, void* out)
+    {
+        return IniValue::parse(text, *static_cast<T*>(out));
+    }
+
+    /// Runs parse on a value while it is guaranteed to stay alive, or copies its cached conversion
+    /// of the same type (size bytes, tagged type, nullptr for none); false if the key is missing or parse fails.
+    bool parseEntry(std::string_view section, std::string_view key, bool (*parse)(std::string_view, void*), void* out,
+                    const void* type, std::size_t size);
+
+    /// parseEntry() for the entry a handle refers to.
+    bool parseHandle(keyHandle& handle, bool (*parse)(std::string_view, void*), void* out, const void* type, std::size_t size);
+
+    /// Copies a cached conversion of a found value into out, or parses it and caches the result.
+    static bool convert(const foundValue& value, bool (*parse)(std::string_view, void*), void* out, const void* type,
+                        std::size_t size);
+
+    /// The entry a handle refers to, re-resolving it if the layout moved on; needs at least the shared lock and a thawed model.
+    const entryView* locate(keyHandle& handle);
+
+    /// Body of the watcher thread: waits for events on the file until watchStop is signalled.
+    void watchLoop(int notifyFd, int stopFd);
+
+    /// Re-parses after a change notification unless the model still matches the file; true if it re-read.
+    bool refreshWatched();
+
+    /// Publishes a copy of the model in snapshot mode and retires the previous one; needs the exclusive lock.
+    void publish();
+
+    /// Retires the published snapshot, if any; needs the exclusive lock.
+    void unpublish();
+
+    /// Returns the published snapshot if it may answer a lookup, or nullptr; call inside an IniEpoch::guard.
+    const snapshot* freshSnapshot() const;
+
+    /// Reads the stat() identity of the file, or false when it cannot be read.
+    bool statFile(fileStamp& out) const;
+
+    /// Sections scanned from one slice of the file.
+    struct parsedChunk {
+        explicit parsedChunk(std::pmr::memory_resource* memory) : leading(memory), memory(memory) {}
+
+        entryList leading;              ///< Entries before the slice's first header; they belong to the previous slice's last section.
+        std::size_t leadingEnd = npos;  ///< File offset just past the last of them.
+        std::vector<sectionView> sections;
+        std::pmr::memory_resource* memory; ///< Where the slice's entry lists are allocated.
+    };
+
+    /// Scans text[begin, end), which must start at a line, into out; views and offsets refer to the whole text.
+    static void scanChunk(std::string_view text, std::size_t begin, std::size_t end, parsedChunk& out);
+
+    /// Interns every section and key name and rebuilds parsed.index from parsed.sections, filling the
+    /// per-section key maps on up to threads threads.
+    void buildIndex(unsigned threads);
+
+    /// Fills the key map of an indexed section; the first entry with a given name wins.
+    void indexEntries(sectionIndex& index);
+
+    /// Adds parsed.sections[position] to the index; the first section with a given name wins.
+    sectionIndex& indexSection(std::size_t position);
+
+    /// Returns the first section with this name, or nullptr.
+    sectionIndex* findSection(std::string_view name);
+    sectionIndex* findSection(nameId id);
+
+    /// Returns the first entry with this key in the first matching section, or nullptr.
+    entryView* findEntry(std::string_view section, std::string_view key);
+
+    /// ID of an interned name, or noName if no section or key has ever had it.
+    nameId idOf(std::string_view name) const;
+
+    /// Interns a name that lives as long as the model, such as a slice of the source.
+    nameId intern(std::string_view name);
+
+    /// Interns a section or key name from the caller's buffer, copying it the first time it is seen;
+    /// in the arena when there is one.
+    nameId keep(std::string_view name);
+
+    /// Drops the model and starts an empty one on threads arenas readied for a file of bytes, or on the heap.
+    void resetModel(unsigned threads, std::size_t bytes);
+
+    /// Memory for the model parts built by parse thread worker.
+    std::pmr::memory_resource* memoryFor(std::size_t worker);
+
+    /// Finds the section, appending an empty one if it does not exist.
+    sectionIndex& sectionFor(std::string_view name);
+
+    /// Finds the entry about to be changed, appending one with an empty value if it does not exist.
+    entryView& entryFor(std::string_view section, std::string_view key);
+
+    /// Stores a new value for an entry, reusing the string it already owns.
+    void assignValue(entryView& entry, std::string_view value);
+    void assignValue(entryView& entry, std::string&& value);
+
+    /// Replaces the entries of a section with copies or moves of the given ones.
+    template <typename Section>
+    bool replaceSection(Section&& section);
 };
@@ -0,0 +1,199 @@
+/**
+ * @file iniLayers.cpp
+ * @brief Implementation of the layered INI view (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniLayers.h"
+
+#include <mutex>
+
+IniLayers::IniLayers(std::vector<IniHandler*> handlers)
+{
+    for (IniHandler* handler : handlers)
+        if (handler)
+            layers.push_back({ handler, 0, false, {} });
+}
+
+std::string IniLayers::readEntry(std::string_view section, std::string_view key)
+{
+    std::string value;
+    lookup(section, key, [&](const std::string& text) { value = text; });
+    return value;
+}
+
+std::size_t IniLayers::layerOf(std::string_view section, std::string_view key)
+{
+    std::shared_lock lock = current();
+    auto it = merged.find({ section, key });
+    return it == merged.end() ? npos : it->second.layer;
+}
+
+bool IniLayers::refresh()
+{
+    bool ok = true;
+    for (const layer& l : layers)
+        ok = l.handler->refresh() && ok;
+    current();
+    return ok;
+}
+
+std::shared_lock<std::shared_mutex> IniLayers::current()
+{
+    std::shared_lock shared(mutex);
+    if (!stale())
+        return shared;
+
+    shared.unlock();
+    {
+        std::unique_lock exclusive(mutex);
+        sync();
+    }
+    shared.lock();
+    return shared;
+}
+
+bool IniLayers::stale() const
+{
+    for (const layer& l : layers)
+        if (!l.merged || l.handler->generation() != l.generation)
+            return true;
+    return false;
+}
+
+void IniLayers::sync()
+{
+    std::vector<IniHandler::iniChange> changed;
+    for (std::size_t i = 0; i < layers.size(); ++i)
+    {
+        layer& l = layers[i];
+        std::uint64_t generation = l.handler->generation();
+        if (l.merged && generation == l.generation)
+            continue;
+
+        if (!l.merged || !l.handler->readChanges(l.generation, changed, generation))
+        {
+            reread(i);
+            continue;
+        }
+
+        for (auto& change : changed)
+        {
+            std::string_view section = intern(change.section.name);
+            if (change.whole)
+            {
+                sectionContents contents;
+                for (auto& entry : change.section.entries)
+                    contents.try_emplace(intern(entry.name), std::move(entry.value));
+                remerge(i, section, std::move(contents));
+            }
+            else
+            {
+                for (const auto& entry : change.section.entries)
+                    mergeKey(i, section, intern(entry.name), entry.value);
+            }
+        }
+        l.generation = generation;
+    }
+}
+
+void IniLayers::reread(std::size_t position)
+{
+    layer& l = layers[position];
+
+    // Parse first, or the parse inside readFile() would move the generation and force a second read.
+    // Taken before reading, so a change racing with the read is picked up next time.
+    l.handler->refresh();
+    std::uint64_t generation = l.handler->generation();
+    IniHandler::iniFile file = l.handler->readFile();
+
+    std::unordered_map<std::string_view, sectionContents> sections;
+    for (auto& section : file.sections)
+    {
+        auto [it, first] = sections.try_emplace(intern(section.name));
+        if (!first)
+            continue;
+        for (auto& entry : section.entries)
+            it->second.try_emplace(intern(entry.name), std::move(entry.value));
+    }
+
+    std::vector<std::string_view> gone;
+    for (const auto& [name, contents] : l.sections)
+        if (!sections.count(name))
+            gone.push_back(name);
+    for (std::string_view name : gone)
+        remerge(position, name, {});
+    for (auto& [name, contents] : sections)
+        remerge(position, name, std::move(contents));
+
+    l.generation = generation;
+    l.merged = true;
+}
+
+void IniLayers::remerge(std::size_t position, std::string_view section, sectionContents&& contents)
+{
+    layer& l = layers[position];
+
+    // Keys this layer no longer has fall through to the nearest lower layer that does.
+    auto old = l.sections.find(section);
+    if (old != l.sections.end())
+    {
+        std::vector<std::string_view> removed;
+        for (const auto& [key, value] : old->second)
+            if (!contents.count(key))
+                removed.push_back(key);
+        for (std::string_view key : removed)
+        {
+            old->second.erase(key);
+            dropKey(position, section, key);
+        }
+    }
+
+    for (const auto& [key, value] : contents)
+        mergeKey(position, section, key, value);
+
+    if (contents.empty())
+        l.sections.erase(section);
+}
+
+void IniLayers::mergeKey(std::size_t position, std::string_view section, std::string_view key, const std::string& value)
+{
+    auto [stored, added] = layers[position].sections[section].try_emplace(key, value);
+    if (!added)
+    {
+        if (stored->second == value)
+            return;
+        stored->second = value;
+    }
+
+    auto it = merged.find({ section, key });
+    if (it == merged.end())
+        merged.emplace(nameKey{ section, key }, mergedValue{ value, position });
+    else if (it->second.layer <= position)
+        it->second = { value, position };
+}
+
+void IniLayers::dropKey(std::size_t position, std::string_view section, std::string_view key)
+{
+    auto it = merged.find({ section, key });
+    if (it == merged.end() || it->second.layer != position)
+        return;
+
+    merged.erase(it);
+    for (std::size_t below = position; below-- > 0;)
+    {
+        auto s = layers[below].sections.find(section);
+        if (s == layers[below].sections.end())
+            continue;
+        auto found = s->second.find(key);
+        if (found != s->second.end())
+        {
+            merged.emplace(nameKey{ section, key }, mergedValue{ found->second, below });
+            break;
+        }
+    }
+}
+
+std::string_view IniLayers::intern(std::string_view name)
+{
+    return *names.emplace(name).first;
+}
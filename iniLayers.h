@@ -0,0 +1,165 @@
+/**
+ * @file iniLayers.h
+ * @brief Several INI files stacked into one view with a merged index (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include "iniHandler.h"
+
+#include <cstddef>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/// @class IniLayers
+/// @brief Looks keys up across stacked IniHandlers, later layers overriding earlier ones.
+///
+/// A merged index maps every (section, key) to the value of the layer that
+/// wins it, so a lookup is one hash probe however many layers there are.
+/// Each layer's generation() is checked on every lookup; when one moved,
+/// only the keys and sections written since are copied from that layer
+/// (see IniHandler::readChanges()) and merged. After the layer re-parses
+/// its file, it is read again whole and diffed against its previous
+/// contents, which costs time in proportion to the layer.
+///
+/// Within a layer the same rules as IniHandler apply: the first section
+/// with a given name and the first key within it win. The handlers are not
+/// owned and must outlive the view. All members may be called from several
+/// threads at once.
+class IniLayers
+{
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief Stacks handlers, lowest precedence first.
+     *
+     * @param layers Handlers in order of increasing precedence; nullptrs are skipped.
+     *
+     * @code
+     * IniHandler defaults("defaults.ini"), site("site.ini"), host("host.ini");
+     * IniLayers config({ &defaults, &site, &host });
+     * std::string port = config.readEntry("Server", "Port"); // host.ini wins, then site.ini
+     * @endcode
+     */
+    explicit IniLayers(std::vector<IniHandler*> layers);
+
+    IniLayers(const IniLayers&) = delete;
+    IniLayers& operator=(const IniLayers&) = delete;
+
+    /**
+     * @brief Looks up the winning value of a key.
+     *
+     * @return The value, or an empty string if no layer has the key.
+     */
+    std::string readEntry(std::string_view section, std::string_view key);
+
+    /**
+     * @brief Looks up and converts the winning value of a key, as IniHandler::get does.
+     *
+     * @return The value, or std::nullopt if no layer has the key or it does not convert.
+     */
+    template <typename T>
+    std::optional<T> get(std::string_view section, std::string_view key)
+    {
+        T value{};
+        bool found = false;
+        lookup(section, key, [&](const std::string& text) { found = IniValue::parse(text, value); });
+        if (!found)
+            return std::nullopt;
+        return value;
+    }
+
+    /**
+     * @brief Tells which layer supplies a key.
+     *
+     * @return Index into the constructor's list, or npos if no layer has the key.
+     */
+    std::size_t layerOf(std::string_view section, std::string_view key);
+
+    /**
+     * @brief Checks every layer's file on disk, re-parsing and re-merging the ones that changed.
+     *
+     * Lookups only see changes a layer has already picked up (through
+     * watch(), reload(), a write or any of its own lookups); this makes
+     * them pick up edits made by other processes as well.
+     *
+     * @return true if every layer could be read.
+     */
+    bool refresh();
+
+private:
+    /// A (section, key) pair; the views point into names.
+    using nameKey = std::pair<std::string_view, std::string_view>;
+
+    struct nameKeyHash {
+        std::size_t operator()(const nameKey& k) const
+        {
+            std::size_t h = std::hash<std::string_view>()(k.first);
+            return h ^ (std::hash<std::string_view>()(k.second) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+        }
+    };
+
+    template <typename T>
+    using keyMap = std::unordered_map<nameKey, T, nameKeyHash>;
+
+    /// Keys of one section and their values; the views point into names.
+    using sectionContents = std::unordered_map<std::string_view, std::string>;
+
+    struct layer {
+        IniHandler* handler = nullptr;
+        std::uint64_t generation = 0; ///< handler->generation() the sections reflect.
+        bool merged = false;          ///< sections have been taken at least once.
+        std::unordered_map<std::string_view, sectionContents> sections; ///< First section of each name, first key within it.
+    };
+
+    /// The value of a key and the layer it comes from.
+    struct mergedValue {
+        std::string value;
+        std::size_t layer;
+    };
+
+    /// Brings the merged index up to date and calls found with the winning value under the shared lock.
+    template <typename Found>
+    void lookup(std::string_view section, std::string_view key, Found&& found)
+    {
+        std::shared_lock lock = current();
+        auto it = merged.find({ section, key });
+        if (it != merged.end())
+            found(it->second.value);
+    }
+
+    /// Shared lock over an index that reflects every layer's current generation.
+    std::shared_lock<std::shared_mutex> current();
+
+    /// True when some layer's generation moved since it was merged; needs at least the shared lock.
+    bool stale() const;
+
+    /// Copies what changed in the layers whose generation moved and merges it; needs the exclusive lock.
+    void sync();
+
+    /// Reads a layer whole and merges its differences; needs the exclusive lock.
+    void reread(std::size_t position);
+
+    /// Replaces one section of a layer, updating only the merged keys that changed.
+    void remerge(std::size_t position, std::string_view section, sectionContents&& contents);
+
+    /// Sets a key in a layer and lets it win unless a higher layer has it too.
+    void mergeKey(std::size_t position, std::string_view section, std::string_view key, const std::string& value);
+
+    /// Removes a key from the merged index if a layer provided it, falling through to the nearest lower layer that has it.
+    void dropKey(std::size_t position, std::string_view section, std::string_view key);
+
+    /// Stable copy of a name for the index keys.
+    std::string_view intern(std::string_view name);
+
+    std::vector<layer> layers;
+    keyMap<mergedValue> merged;
+    std::unordered_set<std::string> names; ///< Every section and key name seen; never shrinks.
+    mutable std::shared_mutex mutex;
+};
@@ -0,0 +1,82 @@
+/**
+ * @file iniLoader.cpp
+ * @brief Implementation of the concurrent INI loader (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+
+std::vector<IniLoader::loadedFile> IniLoader::load(const std::vector<std::filesystem::path>& paths, const settings& config)
+{
+    std::vector<loadedFile> files(paths.size());
+
+    // Workers take the next unclaimed file until none is left; the caller is one of them.
+    std::atomic<std::size_t> nextFile = 0;
+    auto work = [&] {
+        for (std::size_t i = nextFile.fetch_add(1); i < files.size(); i = nextFile.fetch_add(1))
+        {
+            loadedFile& file = files[i];
+            file.path = paths[i];
+
+            auto start = std::chrono::steady_clock::now();
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(file.path, ec))
+                continue;
+
+            auto handler = std::make_unique<IniHandler>(file.path);
+            handler->setParseMode(config.readMode);
+            handler->setReloadPolicy(config.policy);
+            handler->setCompiledCache(config.compiledCache);
+            handler->setStorageMode(config.storage);
+            if (handler->reload())
+                file.handler = std::move(handler);
+            file.loadTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        }
+    };
+
+    std::size_t threads = std::min<std::size_t>(std::max(config.threads, 1u), files.size());
+    std::vector<std::thread> workers;
+    workers.reserve(threads > 0 ? threads - 1 : 0);
+    for (std::size_t i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    return files;
+}
+
+std::vector<IniLoader::loadedFile> IniLoader::load(const std::vector<std::filesystem::path>& paths)
+{
+    return load(paths, settings());
+}
+
+std::vector<IniLoader::loadedFile> IniLoader::loadDirectory(const std::filesystem::path& directory, const settings& config)
+{
+    std::vector<std::filesystem::path> paths;
+    std::error_code ec;
+    std::filesystem::directory_iterator it(directory, ec);
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+    {
+        std::error_code typeError;
+        if (!it->is_regular_file(typeError))
+            continue;
+        if (!config.extension.empty() && it->path().extension() != config.extension)
+            continue;
+        paths.push_back(it->path());
+    }
+    if (ec)
+        return {};
+
+    std::sort(paths.begin(), paths.end(), [](const auto& a, const auto& b) { return a.filename() < b.filename(); });
+    return load(paths, config);
+}
+
+std::vector<IniLoader::loadedFile> IniLoader::loadDirectory(const std::filesystem::path& directory)
+{
+    return loadDirectory(directory, settings());
+}
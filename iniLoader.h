@@ -0,0 +1,81 @@
+/**
+ * @file iniLoader.h
+ * @brief Concurrent loading of many INI files, such as a conf.d directory (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include "iniHandler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @class IniLoader
+/// @brief Opens and parses a set of INI files on a bounded number of threads.
+///
+/// Each file gets its own IniHandler, parsed once before it is handed back,
+/// so the first lookup on it costs no I/O. Files that do not exist are
+/// reported rather than created.
+class IniLoader
+{
+public:
+    /// How the handlers are set up before their first parse.
+    struct settings {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency()); ///< Files loaded at once.
+        IniHandler::parseMode readMode = IniHandler::parseMode::buffered;
+        IniHandler::reloadPolicy policy = IniHandler::reloadPolicy::onChange;
+        bool compiledCache = false;     ///< See IniHandler::setCompiledCache().
+        IniHandler::storageMode storage = IniHandler::storageMode::heap;
+        std::string extension = ".ini"; ///< Files loadDirectory() picks up; empty for every regular file.
+    };
+
+    /// One file's outcome.
+    struct loadedFile {
+        std::filesystem::path path;
+        std::unique_ptr<IniHandler> handler; ///< Ready to use, or nullptr if the file could not be read.
+        std::chrono::nanoseconds loadTime{}; ///< Time spent opening and parsing it.
+    };
+
+    /**
+     * @brief Loads the given files.
+     *
+     * @param paths Files to load.
+     * @param config Thread bound and handler settings.
+     * @return One loadedFile per path, in the same order.
+     *
+     * @code
+     * auto files = IniLoader::load({ "app.ini", "db.ini" });
+     * for (const auto& f : files)
+     *     if (!f.handler)
+     *         std::cerr << "cannot read " << f.path << "\n";
+     * @endcode
+     */
+    static std::vector<loadedFile> load(const std::vector<std::filesystem::path>& paths, const settings& config);
+
+    /// @brief Loads the given files with the default settings.
+    static std::vector<loadedFile> load(const std::vector<std::filesystem::path>& paths);
+
+    /**
+     * @brief Loads every file with the configured extension in a directory, not recursing.
+     *
+     * Files are ordered by name, the usual conf.d convention for which file
+     * takes precedence.
+     *
+     * @param directory Directory to scan.
+     * @param config Thread bound, extension and handler settings.
+     * @return The loaded files by name, or none if the directory cannot be read.
+     *
+     * @code
+     * for (const auto& f : IniLoader::loadDirectory("/etc/app/conf.d"))
+     *     std::cout << f.path << ": " << f.loadTime.count() << " ns\n";
+     * @endcode
+     */
+    static std::vector<loadedFile> loadDirectory(const std::filesystem::path& directory, const settings& config);
+
+    /// @brief Loads the ".ini" files of a directory with the default settings.
+    static std::vector<loadedFile> loadDirectory(const std::filesystem::path& directory);
+};
@@ -0,0 +1,230 @@
+/**
+ * @file iniScanner.cpp
+ * @brief Implementation of the line and delimiter scanner (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniScanner.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define INI_SCANNER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace
+{
+    /// Writes one '\n' mask and one '=' mask per 64-byte block.
+    using classifyFn = void (*)(const char* data, std::size_t blocks, std::uint64_t* newlines, std::uint64_t* equals);
+
+    void classifyScalar(const char* data, std::size_t blocks, std::uint64_t* newlines, std::uint64_t* equals)
+    {
+        for (std::size_t b = 0; b < blocks; ++b, data += 64)
+        {
+            std::uint64_t nl = 0;
+            std::uint64_t eq = 0;
+            for (unsigned i = 0; i < 64; ++i)
+            {
+                nl |= std::uint64_t(data[i] == '\n') << i;
+                eq |= std::uint64_t(data[i] == '=') << i;
+            }
+            newlines[b] = nl;
+            equals[b] = eq;
+        }
+    }
+
+#ifdef INI_SCANNER_X86
+    inline std::uint64_t match16(__m128i bytes, __m128i c)
+    {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, c)));
+    }
+
+    void classifySse2(const char* data, std::size_t blocks, std::uint64_t* newlines, std::uint64_t* equals)
+    {
+        const __m128i nlChar = _mm_set1_epi8('\n');
+        const __m128i eqChar = _mm_set1_epi8('=');
+        for (std::size_t b = 0; b < blocks; ++b, data += 64)
+        {
+            __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+            __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+            newlines[b] = match16(v0, nlChar) | match16(v1, nlChar) << 16 | match16(v2, nlChar) << 32 | match16(v3, nlChar) << 48;
+            equals[b] = match16(v0, eqChar) | match16(v1, eqChar) << 16 | match16(v2, eqChar) << 32 | match16(v3, eqChar) << 48;
+        }
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((target("avx2")))
+#endif
+    void classifyAvx2(const char* data, std::size_t blocks, std::uint64_t* newlines, std::uint64_t* equals)
+    {
+        const __m256i nlChar = _mm256_set1_epi8('\n');
+        const __m256i eqChar = _mm256_set1_epi8('=');
+        for (std::size_t b = 0; b < blocks; ++b, data += 64)
+        {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+            std::uint64_t nlLo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nlChar)));
+            std::uint64_t nlHi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nlChar)));
+            std::uint64_t eqLo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, eqChar)));
+            std::uint64_t eqHi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, eqChar)));
+            newlines[b] = nlLo | nlHi << 32;
+            equals[b] = eqLo | eqHi << 32;
+        }
+    }
+
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4];
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    struct kernel {
+        classifyFn classify;
+        const char* name;
+    };
+
+    const kernel& selectKernel()
+    {
+        static const kernel selected = [] {
+#ifdef INI_SCANNER_X86
+            if (cpuHasAvx2())
+                return kernel{ classifyAvx2, "avx2" };
+            return kernel{ classifySse2, "sse2" };
+#else
+            return kernel{ classifyScalar, "scalar" };
+#endif
+        }();
+        return selected;
+    }
+}
+
+const char* IniScanner::kernelName()
+{
+    return selectKernel().name;
+}
+
+bool IniScanner::selfCheck()
+{
+    constexpr std::size_t blocks = windowBlocks;
+    char data[blocks * 64];
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (std::size_t i = 0; i < sizeof(data); ++i)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        unsigned pick = static_cast<unsigned>(state >> 56);
+        data[i] = pick < 64 ? '\n' : pick < 128 ? '=' : static_cast<char>(i < 256 ? i : pick);
+    }
+
+    std::uint64_t newlines[2][blocks];
+    std::uint64_t equals[2][blocks];
+    selectKernel().classify(data, blocks, newlines[0], equals[0]);
+    classifyScalar(data, blocks, newlines[1], equals[1]);
+    return std::memcmp(newlines[0], newlines[1], sizeof(newlines[0])) == 0
+        && std::memcmp(equals[0], equals[1], sizeof(equals[0])) == 0;
+}
+
+bool IniScanner::fill()
+{
+    if (scanned >= text.size())
+        return false;
+
+    std::size_t remaining = text.size() - scanned;
+    std::size_t blocks = remaining / 64;
+    windowBase = scanned;
+    block = 0;
+
+    if (blocks > 0)
+    {
+        if (blocks > windowBlocks)
+            blocks = windowBlocks;
+        selectKernel().classify(text.data() + scanned, blocks, newlines, equals);
+        windowCount = blocks;
+        scanned += blocks * 64;
+        return true;
+    }
+
+    // The tail is padded with zeros, which match neither '\n' nor '='.
+    char tail[64] = {};
+    std::memcpy(tail, text.data() + scanned, remaining);
+    selectKernel().classify(tail, 1, newlines, equals);
+    windowCount = 1;
+    scanned += remaining;
+    return true;
+}
+
+std::size_t IniScanner::next(iniLine* out, std::size_t count)
+{
+    std::size_t produced = 0;
+    while (produced < count)
+    {
+        if (block == windowCount && !fill())
+        {
+            if (!finished)
+            {
+                finished = true;
+                if (lineStart < text.size())
+                    out[produced++] = makeLine(text.size(), text.size());
+            }
+            break;
+        }
+
+        std::size_t base = windowBase + block * 64;
+        std::uint64_t& nl = newlines[block];
+        std::uint64_t& eq = equals[block];
+
+        while (nl && produced < count)
+        {
+            unsigned bit = static_cast<unsigned>(std::countr_zero(nl));
+            std::uint64_t upTo = (std::uint64_t(2) << bit) - 1; // bits [0, bit]; wraps to all ones for bit 63
+            if (firstEquals == npos && (eq & upTo))
+                firstEquals = base + static_cast<std::size_t>(std::countr_zero(eq));
+
+            out[produced++] = makeLine(base + bit, base + bit + 1);
+            lineStart = base + bit + 1;
+            firstEquals = npos;
+            nl &= nl - 1;
+            eq &= ~upTo;
+        }
+        if (nl)
+            break;
+
+        if (firstEquals == npos && eq)
+            firstEquals = base + static_cast<std::size_t>(std::countr_zero(eq));
+        eq = 0;
+        ++block;
+    }
+    return produced;
+}
+
+IniScanner::iniLine IniScanner::makeLine(std::size_t end, std::size_t next) const
+{
+    iniLine line{ lineStart, end, next, firstEquals, lineKind::other };
+    if (line.end > line.begin && text[line.end - 1] == '\r')
+        --line.end;
+
+    if (line.end == line.begin)
+        line.kind = lineKind::blank;
+    else if (text[line.begin] == ';' || text[line.begin] == '#')
+        line.kind = lineKind::comment;
+    else if (text[line.begin] == '[' && text[line.end - 1] == ']')
+        line.kind = lineKind::section;
+    else if (line.delimiter != npos)
+        line.kind = lineKind::entry;
+    return line;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file iniScanner.h
+ * @brief Line and delimiter scanner used by Daniel's INI Handler (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/// @class IniScanner
+/// @brief Splits an INI buffer into classified lines.
+///
+/// The buffer is scanned in 64-byte blocks by an SSE2, AVX2 or scalar kernel
+/// (picked once at runtime) that produces a structural index: one bitmask of
+/// '\n' positions and one of '=' positions per block. Lines are then cut from
+/// the newline bits, and the remaining structural characters ('\r', '[', ']',
+/// ';', '#') are resolved at the line edges, the only place they matter.
+class IniScanner
+{
+public:
+    enum class lineKind : unsigned char {
+        blank,   ///< Empty line.
+        section, ///< "[name]"
+        entry,   ///< "key=value"
+        comment, ///< Starts with ';' or '#'.
+        other    ///< Anything else; ignored by the parser.
+    };
+
+    struct iniLine {
+        std::size_t begin;     ///< Offset of the first byte of the line.
+        std::size_t end;       ///< Offset one past the last byte, excluding "\r\n" or "\n".
+        std::size_t next;      ///< Offset of the following line.
+        std::size_t delimiter; ///< Offset of the first '=', or npos.
+        lineKind kind;
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief Prepares a scan of the given text; the text must outlive the scanner.
+     *
+     * @code
+     * IniScanner scanner(text);
+     * IniScanner::iniLine lines[256];
+     * while (std::size_t n = scanner.next(lines, 256)) { ... }
+     * @endcode
+     */
+    explicit IniScanner(std::string_view input) : text(input) {}
+
+    /**
+     * @brief Fills up to @p count lines.
+     *
+     * @return The number of lines written, or 0 once the text is exhausted.
+     */
+    std::size_t next(iniLine* out, std::size_t count);
+
+    /// Name of the kernel selected for this CPU ("avx2", "sse2" or "scalar").
+    static const char* kernelName();
+
+    /**
+     * @brief Cross-checks the selected kernel against the portable scalar one.
+     *
+     * Classifies a fixed pseudo-random buffer, dense in '\n' and '=' bytes
+     * and covering every byte value, with both kernels and compares the masks.
+     *
+     * @return true if they agree (always, when the scalar kernel is the selected one).
+     */
+    static bool selfCheck();
+
+private:
+    /// Number of 64-byte blocks classified per kernel call.
+    static constexpr std::size_t windowBlocks = 64;
+
+    std::string_view text;
+    std::uint64_t newlines[windowBlocks] = {};
+    std::uint64_t equals[windowBlocks] = {};
+    std::size_t scanned = 0;      ///< Bytes classified so far.
+    std::size_t windowBase = 0;   ///< Offset of the first block in the window.
+    std::size_t windowCount = 0;  ///< Blocks classified in the window.
+    std::size_t block = 0;        ///< Current block within the window.
+    std::size_t lineStart = 0;
+    std::size_t firstEquals = npos;
+    bool finished = false;
+
+    /// Classifies the next window of blocks; false when the text is exhausted.
+    bool fill();
+
+    iniLine makeLine(std::size_t end, std::size_t next) const;
+};
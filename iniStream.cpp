@@ -0,0 +1,96 @@
+/**
+ * @file iniStream.cpp
+ * @brief Implementation of the streaming callback parser (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniStream.h"
+#include "iniScanner.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+IniStream::result IniStream::parse(const std::filesystem::path& path, const handlers& on, std::size_t chunkSize)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return result::failed;
+
+    if (chunkSize == 0)
+        chunkSize = 1;
+
+    state current;
+    std::string buffer;
+    std::size_t kept = 0; // Bytes of a partial line carried over from the previous chunk.
+    for (;;)
+    {
+        // Only grows past one chunk while a single line is longer than that.
+        if (buffer.size() < kept + chunkSize)
+            buffer.resize(kept + chunkSize);
+
+        in.read(buffer.data() + kept, static_cast<std::streamsize>(chunkSize));
+        if (in.bad())
+            return result::failed;
+
+        std::size_t got = static_cast<std::size_t>(in.gcount());
+        bool last = got < chunkSize;
+        std::string_view text(buffer.data(), kept + got);
+
+        // Cut after the last newline, so the scanner never sees half a line (or half a "\r\n").
+        std::size_t cut = text.size();
+        if (!last)
+        {
+            std::size_t newline = text.rfind('\n');
+            cut = newline == std::string_view::npos ? 0 : newline + 1;
+        }
+
+        if (!scan(text.substr(0, cut), on, current))
+            return result::stopped;
+        if (last)
+            return result::finished;
+
+        kept = text.size() - cut;
+        std::memmove(buffer.data(), buffer.data() + cut, kept);
+    }
+}
+
+IniStream::result IniStream::parseText(std::string_view text, const handlers& on)
+{
+    state current;
+    return scan(text, on, current) ? result::finished : result::stopped;
+}
+
+bool IniStream::scan(std::string_view text, const handlers& on, state& current)
+{
+    IniScanner scanner(text);
+    IniScanner::iniLine lines[256];
+    while (std::size_t count = scanner.next(lines, std::size(lines)))
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto& line = lines[i];
+            switch (line.kind)
+            {
+            case IniScanner::lineKind::section:
+                current.section.assign(text.substr(line.begin + 1, line.end - line.begin - 2));
+                current.inSection = true;
+                if (on.onSection && !on.onSection(current.section))
+                    return false;
+                break;
+            case IniScanner::lineKind::entry:
+                if (current.inSection && on.onEntry
+                    && !on.onEntry(current.section, text.substr(line.begin, line.delimiter - line.begin),
+                                   text.substr(line.delimiter + 1, line.end - line.delimiter - 1)))
+                    return false;
+                break;
+            case IniScanner::lineKind::comment:
+                if (on.onComment && !on.onComment(text.substr(line.begin, line.end - line.begin)))
+                    return false;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return true;
+}
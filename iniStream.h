@@ -0,0 +1,82 @@
+/**
+ * @file iniStream.h
+ * @brief Streaming callback parser for INI files of any size (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/// @class IniStream
+/// @brief Parses an INI file in one pass, reporting each line to callbacks instead of building a model.
+///
+/// The file is read in fixed-size chunks; a chunk is cut after its last
+/// newline and the partial line is carried into the next one, so memory
+/// stays at one chunk plus the longest line whatever the file size. Lines
+/// are split and classified by IniScanner, the same tokenizer IniHandler
+/// uses, so both agree on what counts as a section, entry or comment.
+class IniStream
+{
+public:
+    /// Callbacks for each kind of line; any may be left empty. Returning false stops the parse.
+    struct handlers {
+        /// "[name]": receives the name without brackets.
+        std::function<bool(std::string_view name)> onSection;
+        /// "key=value" inside a section; entries before the first section are skipped, as IniHandler does.
+        std::function<bool(std::string_view section, std::string_view key, std::string_view value)> onEntry;
+        /// Line starting with ';' or '#': receives the whole line without its line ending.
+        std::function<bool(std::string_view text)> onComment;
+    };
+
+    /// @brief How a parse ended.
+    enum class result {
+        finished, ///< Every line was reported.
+        stopped,  ///< A callback returned false.
+        failed    ///< The file could not be opened or read.
+    };
+
+    /// Bytes read per chunk unless another size is given.
+    static constexpr std::size_t defaultChunkSize = std::size_t(1) << 20;
+
+    /**
+     * @brief Streams a file through the callbacks.
+     *
+     * Views passed to a callback are only valid during that call.
+     *
+     * @param path File to parse.
+     * @param on Callbacks to invoke, in file order.
+     * @param chunkSize Bytes read at a time; 0 counts as 1. Lines longer than this are still reported whole.
+     * @return result::finished, result::stopped or result::failed.
+     *
+     * @code
+     * std::string found;
+     * IniStream::parse("export.ini", { {}, [&](std::string_view section, std::string_view key, std::string_view value) {
+     *     if (section != "Users" || key != "admin")
+     *         return true;
+     *     found = value;
+     *     return false;
+     * } });
+     * @endcode
+     */
+    static result parse(const std::filesystem::path& path, const handlers& on, std::size_t chunkSize = defaultChunkSize);
+
+    /**
+     * @brief Streams text that is already in memory, such as a mapped file.
+     *
+     * @return result::finished or result::stopped.
+     */
+    static result parseText(std::string_view text, const handlers& on);
+
+private:
+    /// What carries over from one chunk to the next.
+    struct state {
+        std::string section;
+        bool inSection = false;
+    };
+
+    /// Reports the complete lines of text; false if a callback stopped the parse.
+    static bool scan(std::string_view text, const handlers& on, state& current);
+};
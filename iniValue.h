@@ -0,0 +1,291 @@
+/**
+ * @file iniValue.h
+ * @brief Conversions between INI value text and typed values (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+/// @class IniValue
+/// @brief Parses and formats typed values without allocating or throwing.
+///
+/// Supported types are integers, floating point, bool, std::chrono
+/// durations and enums (through their underlying integer). Surrounding
+/// spaces and tabs are ignored when parsing.
+class IniValue
+{
+public:
+    /// Size of the buffer format() writes into; enough for any supported value.
+    static constexpr std::size_t maxFormatted = 64;
+
+    /**
+     * @brief Converts text to a value.
+     *
+     * - Integers: decimal with an optional sign, or hexadecimal with a 0x prefix.
+     * - Floating point: anything std::from_chars accepts, with an optional leading '+'.
+     * - bool: true/false, yes/no, on/off or 1/0, in any case.
+     * - Durations: a count with an optional unit suffix (ns, us, ms, s, min, h, d);
+     *   without a suffix the count is in the duration's own unit. "1.5s" is allowed.
+     *   Non-finite counts and counts the duration cannot hold are rejected.
+     * - Enums: the underlying integer.
+     *
+     * @param text Value as stored in the file.
+     * @param out Receives the value; untouched on failure.
+     * @return true if the whole text was a valid value of the type.
+     *
+     * @code
+     * std::chrono::milliseconds timeout;
+     * IniValue::parse("2s", timeout); // 2000ms
+     * @endcode
+     */
+    template <typename T>
+    static bool parse(std::string_view text, T& out);
+
+    /**
+     * @brief Formats a value so that parse() reads it back unchanged.
+     *
+     * @param value Value to format.
+     * @param buffer Storage the returned view points into.
+     * @return The formatted text.
+     */
+    template <typename T>
+    static std::string_view format(const T& value, char (&buffer)[maxFormatted]);
+
+private:
+    template <typename T>
+    struct isDuration : std::false_type {};
+
+    template <typename Rep, typename Period>
+    struct isDuration<std::chrono::duration<Rep, Period>> : std::true_type {};
+
+    static std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    static bool equalsNoCase(std::string_view text, std::string_view word)
+    {
+        if (text.size() != word.size())
+            return false;
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            char c = text[i];
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c - 'A' + 'a');
+            if (c != word[i])
+                return false;
+        }
+        return true;
+    }
+
+    /// Parses a number from the start of text, leaving the rest in text.
+    template <typename T>
+    static bool parseNumber(std::string_view& text, T& out)
+    {
+        if (text.size() > 1 && text.front() == '+' && text[1] != '-')
+            text.remove_prefix(1);
+
+        std::from_chars_result result{};
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+                result = std::from_chars(text.data() + 2, text.data() + text.size(), out, 16);
+            else
+                result = std::from_chars(text.data(), text.data() + text.size(), out);
+        }
+        else
+        {
+            result = std::from_chars(text.data(), text.data() + text.size(), out);
+        }
+
+        if (result.ec != std::errc())
+            return false;
+        text.remove_prefix(static_cast<std::size_t>(result.ptr - text.data()));
+        return true;
+    }
+
+    template <typename Duration>
+    static bool parseDuration(std::string_view text, Duration& out)
+    {
+        // An integer count keeps full precision; only fractions go through double.
+        std::string_view rest = text;
+        std::int64_t whole = 0;
+        double fraction = 0;
+        bool integral = parseNumber(rest, whole) && (rest.empty() || rest.front() != '.') && (rest.empty() || (rest.front() != 'e' && rest.front() != 'E'));
+        if (!integral)
+        {
+            rest = text;
+            if (!parseNumber(rest, fraction) || !std::isfinite(fraction))
+                return false;
+        }
+
+        std::string_view unit = trim(rest);
+        auto convert = [&](auto one) {
+            using unitType = decltype(one);
+            using rep = typename Duration::rep;
+            if constexpr (std::is_floating_point_v<rep>)
+            {
+                if (integral)
+                    out = std::chrono::duration_cast<Duration>(std::chrono::duration<std::int64_t, typename unitType::period>(whole));
+                else
+                    out = std::chrono::duration_cast<Duration>(std::chrono::duration<double, typename unitType::period>(fraction));
+                return true;
+            }
+            else
+            {
+                // Scale by hand so a count that does not fit is rejected instead of
+                // overflowing inside duration_cast or the cast to rep.
+                using scale = std::ratio_divide<typename unitType::period, typename Duration::period>;
+                if (integral)
+                {
+                    constexpr std::int64_t limit = std::numeric_limits<std::int64_t>::max() / scale::num;
+                    if (whole > limit || whole < -limit)
+                        return false;
+                    std::int64_t ticks = whole * scale::num / scale::den;
+                    if (!std::in_range<rep>(ticks))
+                        return false;
+                    out = Duration(static_cast<rep>(ticks));
+                }
+                else
+                {
+                    double ticks = fraction * static_cast<double>(scale::num) / static_cast<double>(scale::den);
+                    if (!(ticks >= static_cast<double>(std::numeric_limits<rep>::min()) && ticks < static_cast<double>(std::numeric_limits<rep>::max()) + 1.0))
+                        return false;
+                    out = Duration(static_cast<rep>(ticks));
+                }
+                return true;
+            }
+        };
+
+        if (unit.empty())
+            return convert(std::chrono::duration<typename Duration::rep, typename Duration::period>());
+        if (unit == "ns")
+            return convert(std::chrono::nanoseconds());
+        if (unit == "us")
+            return convert(std::chrono::microseconds());
+        if (unit == "ms")
+            return convert(std::chrono::milliseconds());
+        if (unit == "s")
+            return convert(std::chrono::seconds());
+        if (unit == "min")
+            return convert(std::chrono::minutes());
+        if (unit == "h")
+            return convert(std::chrono::hours());
+        if (unit == "d")
+            return convert(std::chrono::duration<std::int64_t, std::ratio<86400>>());
+        return false;
+    }
+
+    template <typename Period>
+    static constexpr std::string_view suffix()
+    {
+        if constexpr (std::is_same_v<Period, std::nano>)
+            return "ns";
+        else if constexpr (std::is_same_v<Period, std::micro>)
+            return "us";
+        else if constexpr (std::is_same_v<Period, std::milli>)
+            return "ms";
+        else if constexpr (std::is_same_v<Period, std::ratio<1>>)
+            return "s";
+        else if constexpr (std::is_same_v<Period, std::ratio<60>>)
+            return "min";
+        else if constexpr (std::is_same_v<Period, std::ratio<3600>>)
+            return "h";
+        else if constexpr (std::is_same_v<Period, std::ratio<86400>>)
+            return "d";
+        else
+            return "";
+    }
+};
+
+template <typename T>
+bool IniValue::parse(std::string_view text, T& out)
+{
+    text = trim(text);
+    if (text.empty())
+        return false;
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        if (text == "1" || equalsNoCase(text, "true") || equalsNoCase(text, "yes") || equalsNoCase(text, "on"))
+            out = true;
+        else if (text == "0" || equalsNoCase(text, "false") || equalsNoCase(text, "no") || equalsNoCase(text, "off"))
+            out = false;
+        else
+            return false;
+        return true;
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        std::underlying_type_t<T> raw{};
+        if (!parse(text, raw))
+            return false;
+        out = static_cast<T>(raw);
+        return true;
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        T value{};
+        if (!parseNumber(text, value) || !text.empty())
+            return false;
+        out = value;
+        return true;
+    }
+    else if constexpr (isDuration<T>::value)
+    {
+        T value{};
+        if (!parseDuration(text, value))
+            return false;
+        out = value;
+        return true;
+    }
+    else
+    {
+        static_assert(std::is_arithmetic_v<T>, "IniValue supports integers, floating point, bool, durations and enums");
+        return false;
+    }
+}
+
+template <typename T>
+std::string_view IniValue::format(const T& value, char (&buffer)[maxFormatted])
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        return value ? "true" : "false";
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return format(static_cast<std::underlying_type_t<T>>(value), buffer);
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        auto result = std::to_chars(buffer, buffer + maxFormatted, value);
+        return { buffer, static_cast<std::size_t>(result.ptr - buffer) };
+    }
+    else if constexpr (isDuration<T>::value)
+    {
+        auto result = std::to_chars(buffer, buffer + maxFormatted, value.count());
+        std::string_view unit = suffix<typename T::period>();
+        for (char c : unit)
+            *result.ptr++ = c;
+        return { buffer, static_cast<std::size_t>(result.ptr - buffer) };
+    }
+    else
+    {
+        static_assert(std::is_arithmetic_v<T>, "IniValue supports integers, floating point, bool, durations and enums");
+        return {};
+    }
+}
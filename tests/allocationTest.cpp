@@ -0,0 +1,93 @@
+/**
+ * @file allocationTest.cpp
+ * @brief Checks that rewriting an existing key inside a batch does not allocate (MIT License)
+ * @author Daniel McGuire
+ *
+ * Global operator new is replaced to count heap allocations. After a few
+ * warm-up writes have grown the key's value string, further writes of
+ * values no longer than the longest so far, shorter and longer in turn,
+ * must not allocate at all.
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace
+{
+    std::atomic<std::uint64_t> allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+    testSupport::scratchDir dir("iniHandler_allocationTest");
+    const auto path = dir / "app.ini";
+    testSupport::writeText(path, "[Server]\nPort=8080\nName=example\n");
+
+    testSupport::checker check;
+    for (auto storage : { IniHandler::storageMode::heap, IniHandler::storageMode::arena })
+    {
+        IniHandler handler(path);
+        handler.setStorageMode(storage);
+        handler.reload();
+
+        // All longer than any small-string buffer, so only reusing the entry's string avoids the heap;
+        // the warm-up grows it to the longest, the steady state shrinks and regrows it.
+        handler.begin();
+        const std::string values[] = { std::string(16, 'a'), std::string(40, 'b'), std::string(100, 'c'), std::string(24, 'd') };
+        for (const std::string& value : values)
+            handler.writeEntry_str("Server", "Name", value);
+
+        std::uint64_t before = allocations.load(std::memory_order_relaxed);
+        for (int i = 0; i < 1000; ++i)
+            handler.writeEntry_str("Server", "Name", values[(i + 3) % 4]);
+        std::uint64_t allocated = allocations.load(std::memory_order_relaxed) - before;
+        handler.rollback();
+
+        check(allocated == 0, std::string(storage == IniHandler::storageMode::heap ? "heap" : "arena") + ": "
+                                  + std::to_string(allocated) + " allocations in 1000 steady-state writes");
+    }
+
+    return check.result();
+}
@@ -0,0 +1,51 @@
+/**
+ * @file handleTest.cpp
+ * @brief Checks that handle reads agree with name lookups in both lookup modes (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+int main()
+{
+    testSupport::scratchDir dir("iniHandler_handleTest");
+    testSupport::writeText(dir / "a.ini", "[Server]\nPort=1\n");
+    testSupport::writeText(dir / "b.ini", "[Other]\nName=x\n[Server]\nPort=5\n");
+
+    testSupport::checker check;
+
+    {
+        IniHandler handler(dir / "a.ini");
+        handler.setLookupMode(IniHandler::lookupMode::snapshot);
+        auto port = handler.resolve("Server", "Port");
+        check(handler.get<int>(port) == 1, "handle read in snapshot mode");
+
+        // Writes in an open batch are published on commit, for handles as for names.
+        handler.begin();
+        handler.set("Server", "Port", 2);
+        check(handler.get<int>("Server", "Port") == 1, "name read inside a batch");
+        check(handler.get<int>(port) == 1 && handler.read(port) == "1", "handle read inside a batch");
+        handler.commit();
+        check(handler.get<int>(port) == 2 && handler.read(port) == "2", "handle read after commit");
+
+        auto missing = handler.resolve("Server", "Host");
+        check(!handler.get<int>(missing) && handler.read(missing).empty(), "missing key in snapshot mode");
+        handler.writeEntry_str("Server", "Host", "example");
+        check(handler.read(missing) == "example", "key added after the handle missed it");
+
+        // A handle used with a second handler must not reuse the first one's snapshot or positions.
+        IniHandler other(dir / "b.ini");
+        check(other.get<int>(port) == 5, "handle moved to a locked handler");
+        other.setLookupMode(IniHandler::lookupMode::snapshot);
+        check(other.get<int>(port) == 5, "handle moved to a snapshot handler");
+        check(handler.get<int>(port) == 2, "handle moved back");
+
+        handler.setLookupMode(IniHandler::lookupMode::locked);
+        handler.begin();
+        handler.set("Server", "Port", 3);
+        check(handler.get<int>(port) == 3 && handler.get<int>("Server", "Port") == 3, "locked reads see the open batch");
+        handler.commit();
+    }
+
+    return check.result();
+}
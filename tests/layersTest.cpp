@@ -0,0 +1,51 @@
+/**
+ * @file layersTest.cpp
+ * @brief Checks that IniLayers follows writes to its layers, incrementally and after re-parses (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniLayers.h"
+#include "testSupport.h"
+
+#include <string>
+
+int main()
+{
+    testSupport::scratchDir dir("iniHandler_layersTest");
+    testSupport::writeText(dir / "defaults.ini", "[Server]\nPort=80\nHost=localhost\nMode=safe\n");
+    testSupport::writeText(dir / "site.ini", "[Server]\nPort=8080\n");
+
+    testSupport::checker check;
+
+    {
+        IniHandler defaults(dir / "defaults.ini"), site(dir / "site.ini");
+        IniLayers config({ &defaults, &site });
+        check(config.readEntry("Server", "Port") == "8080" && config.layerOf("Server", "Port") == 1, "higher layer wins");
+        check(config.readEntry("Server", "Host") == "localhost", "lower layer fills in");
+
+        site.writeEntry_str("Server", "Host", "example");
+        check(config.readEntry("Server", "Host") == "example" && config.layerOf("Server", "Host") == 1, "key added to the higher layer");
+        defaults.writeEntry_str("Server", "Port", "81");
+        check(config.readEntry("Server", "Port") == "8080", "lower layer write stays hidden");
+        defaults.writeEntry_str("Log", "Level", "info");
+        check(config.readEntry("Log", "Level") == "info", "section added to a lower layer");
+
+        // Replacing a section drops the keys it no longer has, letting the lower layer show through.
+        IniHandler::iniSection server;
+        server.name = "Server";
+        server.entries.push_back({ "Host", "example" });
+        site.writeSection(server);
+        check(config.readEntry("Server", "Port") == "81" && config.layerOf("Server", "Port") == 0, "removed key falls through");
+
+        site.begin();
+        for (int i = 0; i < 5000; ++i)
+            site.set("Bulk", "Key" + std::to_string(i), i);
+        site.commit();
+        check(config.get<int>("Bulk", "Key0") == 0 && config.get<int>("Bulk", "Key4999") == 4999, "more writes than the change log holds");
+
+        testSupport::writeText(dir / "site.ini", "[Server]\nMode=fast\n");
+        check(site.reload() && config.readEntry("Server", "Mode") == "fast", "re-parsed layer");
+        check(config.readEntry("Server", "Host") == "localhost", "key gone after a re-parse falls through");
+    }
+
+    return check.result();
+}
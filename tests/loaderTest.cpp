@@ -0,0 +1,84 @@
+/**
+ * @file loaderTest.cpp
+ * @brief Checks that IniLoader loads files in order and reports the ones it cannot read (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniLoader.h"
+#include "testSupport.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main()
+{
+    namespace fs = std::filesystem;
+    testSupport::scratchDir dir("iniHandler_loaderTest");
+
+    // Written in reverse so that directory order is unlikely to match name order by accident.
+    for (int i = 19; i >= 0; --i)
+    {
+        std::string name = (i < 10 ? "0" : "") + std::to_string(i);
+        testSupport::writeText(dir / (name + ".ini"), "[File]\nName=" + name + "\n");
+    }
+    testSupport::writeText(dir / "notes.txt", "[File]\nName=notes\n");
+    fs::create_directory(dir / "nested.ini");
+
+    // Every fifth file is followed by one that does not exist.
+    std::vector<fs::path> paths;
+    for (int i = 0; i < 20; ++i)
+    {
+        std::string name = (i < 10 ? "0" : "") + std::to_string(i);
+        paths.push_back(dir / (name + ".ini"));
+        if (i % 5 == 0)
+            paths.push_back(dir / ("missing" + name + ".ini"));
+    }
+
+    testSupport::checker check;
+
+    std::vector<std::vector<IniHandler::iniFile>> runs;
+    for (unsigned threads : { 1u, 8u })
+    {
+        std::string run = std::to_string(threads) + " threads: ";
+        IniLoader::settings config;
+        config.threads = threads;
+
+        auto files = IniLoader::load(paths, config);
+        check(files.size() == paths.size(), run + "one result per path");
+
+        std::vector<IniHandler::iniFile> contents;
+        for (std::size_t i = 0; i < files.size() && i < paths.size(); ++i)
+        {
+            const auto& file = files[i];
+            check(file.path == paths[i], run + "result " + std::to_string(i) + " in input order");
+
+            std::string stem = paths[i].stem().string();
+            if (stem.starts_with("missing"))
+            {
+                check(!file.handler, run + stem + " reported as unreadable");
+                check(!fs::exists(paths[i]), run + stem + " not created");
+                continue;
+            }
+
+            check(file.handler && file.handler->readEntry_str("File", { "Name", "" }) == stem, run + stem + " loaded");
+            if (file.handler)
+                contents.push_back(file.handler->readFile());
+        }
+        runs.push_back(std::move(contents));
+
+        auto listed = IniLoader::loadDirectory(dir.path(), config);
+        bool sorted = listed.size() == 20;
+        for (std::size_t i = 0; sorted && i < listed.size(); ++i)
+            sorted = listed[i].handler && listed[i].path.filename() == paths[i + (i + 4) / 5].filename();
+        check(sorted, run + "directory loaded by name, skipping other extensions and directories");
+
+        check(IniLoader::loadDirectory(dir / "missing", config).empty(), run + "missing directory loads nothing");
+    }
+
+    bool same = runs.front().size() == runs.back().size();
+    for (std::size_t i = 0; same && i < runs.front().size(); ++i)
+        same = testSupport::sameSections(runs.front()[i], runs.back()[i]);
+    check(same, "same contents at 1 and 8 threads");
+
+    return check.result();
+}
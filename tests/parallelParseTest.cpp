@@ -0,0 +1,107 @@
+/**
+ * @file parallelParseTest.cpp
+ * @brief Checks that a parse split across threads builds the same model as a serial one (MIT License)
+ * @author Daniel McGuire
+ *
+ * The file is big enough for every thread count to get its own slices. The
+ * lines where the two- and four-thread splits cut are rewritten into
+ * headers, while the three-thread splits cut inside sections, so a slice
+ * starts with entries that belong to the previous one. Lines end in a mix
+ * of LF and CRLF, and some sections repeat.
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    /// Where a parse on threads threads starts slice i of text; mirrors IniHandler::readAll().
+    std::size_t sliceStart(const std::string& text, unsigned threads, unsigned i)
+    {
+        return text.find('\n', text.size() / threads * i) + 1;
+    }
+
+    /// Length of the line at start, without its line ending.
+    std::size_t lineLength(const std::string& text, std::size_t start)
+    {
+        std::size_t end = text.find('\n', start);
+        return end - start - (end > start && text[end - 1] == '\r' ? 1 : 0);
+    }
+}
+
+int main()
+{
+    constexpr unsigned maxThreads = 4;
+
+    testSupport::scratchDir dir("iniHandler_parallelParseTest");
+    const auto path = dir / "big.ini";
+
+    std::string text = "; generated\r\nOrphan=dropped\n";
+    std::size_t line = 0;
+    auto append = [&](const std::string& content) { text.append(content).append(++line % 3 == 0 ? "\r\n" : "\n"); };
+    for (std::size_t n = 0; text.size() < IniHandler::parallelChunkBytes * maxThreads * 2; ++n)
+    {
+        append("[Section" + std::to_string(n % 7 == 6 ? n / 2 : n) + "]");
+        for (std::size_t k = 0; k < n % 40 + 1; ++k)
+            append("key" + std::to_string(k) + "=value" + std::to_string(n) + "_" + std::to_string(k));
+        if (n % 11 == 0)
+            append("; comment");
+    }
+    append("[Last]");
+    append("end=1");
+
+    testSupport::checker check;
+
+    // Same-length rewrites keep every slice boundary where it was.
+    for (unsigned threads : { 2u, 4u })
+        for (unsigned i = 1; i < threads; ++i)
+        {
+            std::size_t start = sliceStart(text, threads, i);
+            std::size_t length = lineLength(text, start);
+            text.replace(start, length, "[" + std::string(length - 2, 'B') + "]");
+        }
+    for (unsigned i = 1; i < 3; ++i)
+    {
+        std::size_t start = sliceStart(text, 3, i);
+        check(text.compare(start, 3, "key") == 0, "three-thread slice " + std::to_string(i) + " starts with an entry");
+    }
+    testSupport::writeText(path, text);
+
+    IniHandler serial(path);
+    const IniHandler::iniFile expected = serial.readFile();
+    check(expected.sections.size() > 1000, "file parsed");
+
+    // Lookups see the first section of each name, and the first key of each name in it.
+    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> first;
+    for (const auto& section : expected.sections)
+    {
+        auto [keys, fresh] = first.try_emplace(section.name);
+        if (!fresh)
+            continue;
+        for (const auto& entry : section.entries)
+            keys->second.try_emplace(entry.name, entry.value);
+    }
+
+    for (auto storage : { IniHandler::storageMode::heap, IniHandler::storageMode::arena })
+        for (unsigned threads = 1; threads <= maxThreads; ++threads)
+        {
+            std::string run = std::string(storage == IniHandler::storageMode::arena ? "arena" : "heap") + ", "
+                + std::to_string(threads) + " threads";
+
+            IniHandler handler(path);
+            handler.setStorageMode(storage);
+            handler.setParseThreads(threads);
+            check(handler.reload(), run + ": parsed");
+            check(testSupport::sameSections(handler.readFile(), expected), run + ": same sections and entries as a serial parse");
+
+            bool same = true;
+            for (const auto& [section, keys] : first)
+                for (const auto& [key, value] : keys)
+                    same = same && handler.readEntry_view(section, key) == value;
+            check(same, run + ": same lookups as a serial parse");
+        }
+
+    return check.result();
+}
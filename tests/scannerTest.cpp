@@ -0,0 +1,16 @@
+/**
+ * @file scannerTest.cpp
+ * @brief Checks the selected scanner kernel against the scalar one (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniScanner.h"
+
+#include <iostream>
+
+int main()
+{
+    if (IniScanner::selfCheck())
+        return 0;
+    std::cerr << IniScanner::kernelName() << " kernel disagrees with the scalar kernel\n";
+    return 1;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file streamTest.cpp
+ * @brief Checks that IniStream reports the same lines whatever the chunk size (MIT License)
+ * @author Daniel McGuire
+ *
+ * The file is streamed in chunks from one byte up, so lines, and the
+ * "\r\n" at their end, are split between chunks in every possible place.
+ * Each run must report exactly what parseText() reports for the whole text.
+ */
+#include "iniStream.h"
+#include "testSupport.h"
+
+#include <string>
+
+namespace
+{
+    /// Records every callback as one line of the returned log; stops at the entry named stopAt.
+    IniStream::handlers recorder(std::string& log, std::string_view stopAt = {})
+    {
+        return {
+            [&log](std::string_view name) {
+                log.append("section ").append(name).append("\n");
+                return true;
+            },
+            [&log, stopAt](std::string_view section, std::string_view key, std::string_view value) {
+                log.append("entry ").append(section).append(" ").append(key).append("=").append(value).append("\n");
+                return key != stopAt;
+            },
+            [&log](std::string_view text) {
+                log.append("comment ").append(text).append("\n");
+                return true;
+            },
+        };
+    }
+}
+
+int main()
+{
+    testSupport::scratchDir dir("iniHandler_streamTest");
+    const auto path = dir / "app.ini";
+
+    // An entry before the first header, CRLF and LF lines, a line longer than most chunks and no final newline.
+    const std::string text = "Orphan=1\r\n; settings\r\n[Server]\r\nPort=8080\nHost=" + std::string(200, 'h')
+        + "\r\n\r\n[Log]\nLevel=info\r\n# end\nlast=1";
+    testSupport::writeText(path, text);
+
+    testSupport::checker check;
+
+    std::string expected;
+    check(IniStream::parseText(text, recorder(expected)) == IniStream::result::finished, "whole text parsed");
+    check(expected.find("Orphan") == std::string::npos, "entry before the first header skipped");
+    check(expected.find("entry Log Level=info\n") != std::string::npos, "value without its \"\\r\"");
+    check(expected.ends_with("entry Log last=1\n"), "last line without a newline reported");
+
+    for (std::size_t chunkSize : { std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(3), std::size_t(7), std::size_t(64),
+                                   IniStream::defaultChunkSize })
+    {
+        std::string log;
+        check(IniStream::parse(path, recorder(log), chunkSize) == IniStream::result::finished, "chunk size " + std::to_string(chunkSize) + ": finished");
+        check(log == expected, "chunk size " + std::to_string(chunkSize) + ": same lines as parseText()");
+
+        std::string stopped;
+        check(IniStream::parse(path, recorder(stopped, "Port"), chunkSize) == IniStream::result::stopped, "chunk size " + std::to_string(chunkSize) + ": stopped");
+        check(stopped == expected.substr(0, expected.find("Port=8080\n") + 10), "chunk size " + std::to_string(chunkSize) + ": nothing reported after the stop");
+    }
+
+    std::string none;
+    check(IniStream::parse(dir / "missing.ini", recorder(none)) == IniStream::result::failed && none.empty(), "missing file fails");
+
+    return check.result();
+}
@@ -0,0 +1,34 @@
+/**
+ * @file symlinkTest.cpp
+ * @brief Checks that saving through a symlink replaces its target and keeps the link (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+#include <filesystem>
+#include <iterator>
+
+int main()
+{
+    namespace fs = std::filesystem;
+    testSupport::scratchDir dir("iniHandler_symlinkTest");
+    fs::create_directories(dir / "real");
+    testSupport::writeText(dir / "real" / "app.ini", "[Server]\nPort=8080\n");
+    fs::permissions(dir / "real" / "app.ini", fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    fs::create_symlink(fs::path("real") / "app.ini", dir / "app.ini");
+
+    testSupport::checker check;
+
+    {
+        IniHandler handler(dir / "app.ini");
+        check(handler.writeEntry_str("Server", "Port", "9090"), "save through the link");
+    }
+    check(fs::is_symlink(fs::symlink_status(dir / "app.ini")), "link is still a symlink");
+    check(testSupport::readText(dir / "real" / "app.ini").find("Port=9090") != std::string::npos, "target holds the new value");
+    check(fs::status(dir / "real" / "app.ini").permissions() == (fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read),
+          "target keeps its permissions");
+    check(std::distance(fs::directory_iterator(dir.path()), fs::directory_iterator()) == 2, "no temp file left beside the link");
+
+    return check.result();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file testSupport.h
+ * @brief Check counting and scratch files shared by the iniHandler tests (MIT License)
+ * @author Daniel McGuire
+ */
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace testSupport
+{
+    /// @brief Counts failed checks, reporting each one on std::cerr.
+    ///
+    /// @code
+    /// testSupport::checker check;
+    /// check(handler.readEntry_view("Server", "Port") == "8080", "initial value");
+    /// return check.result();
+    /// @endcode
+    class checker {
+    public:
+        void operator()(bool ok, std::string_view what)
+        {
+            if (ok)
+                return;
+            std::cerr << "failed: " << what << "\n";
+            ++failures;
+        }
+
+        /// Exit code for main(): 0 when every check passed.
+        int result() const { return failures == 0 ? 0 : 1; }
+
+    private:
+        int failures = 0;
+    };
+
+    /// @brief An empty directory under the system temp directory, removed with everything in it on destruction.
+    class scratchDir {
+    public:
+        explicit scratchDir(std::string_view name) : root(std::filesystem::temp_directory_path() / name)
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(root, ec);
+            std::filesystem::create_directories(root);
+        }
+
+        ~scratchDir()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(root, ec);
+        }
+
+        scratchDir(const scratchDir&) = delete;
+        scratchDir& operator=(const scratchDir&) = delete;
+
+        const std::filesystem::path& path() const { return root; }
+        std::filesystem::path operator/(const std::filesystem::path& leaf) const { return root / leaf; }
+
+    private:
+        std::filesystem::path root;
+    };
+
+    /// @brief True when two IniHandler::iniFile results hold the same sections and entries in the same order.
+    template <typename File>
+    bool sameSections(const File& a, const File& b)
+    {
+        if (a.sections.size() != b.sections.size())
+            return false;
+        for (std::size_t s = 0; s < a.sections.size(); ++s)
+        {
+            const auto& x = a.sections[s];
+            const auto& y = b.sections[s];
+            if (x.name != y.name || x.entries.size() != y.entries.size())
+                return false;
+            for (std::size_t e = 0; e < x.entries.size(); ++e)
+                if (x.entries[e].name != y.entries[e].name || x.entries[e].value != y.entries[e].value)
+                    return false;
+        }
+        return true;
+    }
+
+    /// Replaces a file's contents with text, byte for byte.
+    inline void writeText(const std::filesystem::path& file, std::string_view text)
+    {
+        std::ofstream(file, std::ios::binary | std::ios::trunc).write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    /// Reads a whole file, byte for byte; empty if it cannot be read.
+    inline std::string readText(const std::filesystem::path& file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * @file valueTest.cpp
+ * @brief Checks that IniValue rejects durations it cannot represent (MIT License)
+ * @author Daniel McGuire
+ */
+#include "iniValue.h"
+#include "testSupport.h"
+
+#include <chrono>
+#include <cstdint>
+
+int main()
+{
+    using namespace std::chrono_literals;
+
+    testSupport::checker check;
+
+    std::chrono::nanoseconds ns = 1ns;
+    check(!IniValue::parse("inf", ns) && !IniValue::parse("-inf s", ns) && !IniValue::parse("nan", ns), "non-finite counts");
+    check(!IniValue::parse("1e30s", ns) && !IniValue::parse("-1e30s", ns), "fractional count past the range");
+    check(!IniValue::parse("9223372036854775807h", ns) && !IniValue::parse("-9223372036854775807h", ns), "whole count past the range");
+    check(!IniValue::parse("106752d", ns), "days past the nanosecond range");
+    check(ns == 1ns, "failed parses leave the value untouched");
+
+    check(IniValue::parse("106751d", ns) && ns == std::chrono::hours(106751 * 24), "largest whole day in nanoseconds");
+    check(IniValue::parse("9223372036854775807", ns) && ns == std::chrono::nanoseconds::max(), "maximum count without a unit");
+    check(IniValue::parse("1.5s", ns) && ns == 1500ms, "fractional seconds");
+    check(IniValue::parse("-90s", ns) && ns == -90s, "negative seconds");
+
+    std::chrono::duration<std::int32_t, std::milli> narrow{};
+    check(!IniValue::parse("2147484s", narrow), "whole count past a 32-bit range");
+    check(!IniValue::parse("2147483.648s", narrow), "fractional count past a 32-bit range");
+    check(IniValue::parse("2147483.647s", narrow) && narrow.count() == 2147483647, "largest 32-bit count");
+
+    std::chrono::hours hours{};
+    check(IniValue::parse("90min", hours) && hours == 1h, "coarser unit truncates");
+
+    std::chrono::duration<double> seconds{};
+    check(IniValue::parse("1e30s", seconds) && seconds.count() == 1e30, "floating durations keep large counts");
+    check(!IniValue::parse("inf", seconds), "floating durations reject infinity");
+
+    return check.result();
+}
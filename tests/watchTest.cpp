@@ -0,0 +1,67 @@
+/**
+ * @file watchTest.cpp
+ * @brief Checks that watch() picks up edits made by another writer (MIT License)
+ * @author Daniel McGuire
+ *
+ * The file is changed twice behind the handler's back: once rewritten in
+ * place, once replaced by rename as editors save. Each time the watcher
+ * must re-parse it and run the subscribed callback.
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+    /// Waits up to five seconds for done() to hold; a rewrite may be seen half-written first.
+    template <typename Done>
+    bool waitUntil(Done&& done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    namespace fs = std::filesystem;
+    testSupport::scratchDir dir("iniHandler_watchTest");
+    const fs::path path = dir / "app.ini";
+    testSupport::writeText(path, "[Server]\nPort=8080\n");
+
+    testSupport::checker check;
+
+    {
+        IniHandler handler(path);
+        std::atomic<int> changes = 0;
+        handler.subscribe([&] { ++changes; });
+        check(handler.watch(), "watch the file");
+        check(handler.readEntry("Server", { "Port", "" }) == "8080", "initial value");
+
+        int seen = changes.load();
+        testSupport::writeText(path, "[Server]\nPort=9090\n");
+        check(waitUntil([&] { return handler.readEntry("Server", { "Port", "" }) == "9090"; }), "value after an in-place rewrite");
+        check(waitUntil([&] { return changes.load() > seen; }), "callback after an in-place rewrite");
+
+        seen = changes.load();
+        testSupport::writeText(dir / "app.ini.new", "[Server]\nPort=7070\nHost=example\n");
+        fs::rename(dir / "app.ini.new", path);
+        check(waitUntil([&] { return handler.readEntry("Server", { "Port", "" }) == "7070"; }), "value after a rename over the file");
+        check(waitUntil([&] { return changes.load() > seen; }), "callback after a rename over the file");
+        check(handler.readEntry("Server", { "Host", "" }) == "example", "new key after a rename over the file");
+
+        handler.unwatch();
+    }
+
+    return check.result();
+}
@@ -0,0 +1,93 @@
+/**
+ * @file writeTailTest.cpp
+ * @brief Checks that appended and in-place saves leave a file that parses back to the model (MIT License)
+ * @author Daniel McGuire
+ *
+ * The same sequence of writes is run in every save mode, on LF and CRLF
+ * files and with buffered and mapped parsing. After each write the file on
+ * disk is parsed afresh and must hold exactly what the writer's model
+ * holds, and every run must end with the same contents.
+ */
+#include "iniHandler.h"
+#include "testSupport.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    std::string crlf(std::string_view text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            if (c == '\n')
+                out.push_back('\r');
+            out.push_back(c);
+        }
+        return out;
+    }
+}
+
+int main()
+{
+    using saveMode = IniHandler::saveMode;
+    using parseMode = IniHandler::parseMode;
+
+    testSupport::scratchDir dir("iniHandler_writeTailTest");
+    const auto path = dir / "app.ini";
+
+    // A comment and an entry before the first header, a duplicate section and an unterminated last line.
+    const std::string original = "; settings\nOrphan=1\n[A]\na=1\nb=22\n\n[B]\nc=3\n[A]\nd=4\n[C]\nf=6";
+
+    IniHandler::iniSection replacement;
+    replacement.name = "A";
+    replacement.entries = { { "a", "1" } };
+
+    const std::vector<std::pair<const char*, std::function<bool(IniHandler&)>>> steps = {
+        { "key added to the unterminated last section", [](IniHandler& h) { return h.writeEntry_str("C", "g", "7"); } },
+        { "key added to a section that is not last", [](IniHandler& h) { return h.writeEntry_str("A", "x", "new"); } },
+        { "value grown", [](IniHandler& h) { return h.writeEntry_str("B", "c", "a value longer than the one on disk"); } },
+        { "value shrunk", [](IniHandler& h) { return h.writeEntry_str("B", "c", "s"); } },
+        { "section added at the end", [](IniHandler& h) { return h.writeEntry_str("D", "k", "v"); } },
+        { "section replaced by fewer keys", [&](IniHandler& h) { return h.writeSection(replacement); } },
+        { "key added to the new last section", [](IniHandler& h) { return h.writeEntry_str("D", "l", "w"); } },
+    };
+
+    testSupport::checker check;
+    std::vector<IniHandler::iniFile> results;
+    for (bool windows : { false, true })
+        for (auto read : { parseMode::buffered, parseMode::mapped })
+            for (auto save : { saveMode::atomic, saveMode::append, saveMode::incremental })
+            {
+                std::string run = std::string(windows ? "crlf " : "lf ") + (read == parseMode::mapped ? "mapped " : "buffered ")
+                    + (save == saveMode::atomic ? "atomic" : save == saveMode::append ? "append" : "incremental");
+                testSupport::writeText(path, windows ? crlf(original) : original);
+
+                IniHandler handler(path);
+                handler.setParseMode(read);
+                handler.setSaveMode(save);
+                handler.reload();
+
+                for (const auto& [what, step] : steps)
+                {
+                    check(step(handler), run + ": write, " + what);
+                    check(testSupport::sameSections(handler.readFile(), IniHandler(path).readFile()), run + ": file parses back to the model, " + what);
+                }
+                check(handler.readEntry_str("C", { "g", "" }) == "7" && handler.readEntry_str("B", { "c", "" }) == "s", run + ": final values");
+
+                // Only a full rewrite drops what is not a section or entry. Append mode and in-place saves over a mapped
+                // source fall back to one for the writes above the last section; buffered incremental saves never do.
+                bool rewritten = save != saveMode::incremental || read == parseMode::mapped;
+                check((testSupport::readText(path).find("; settings") == std::string::npos) == rewritten, run + ": leading comment kept only by in-place saves");
+
+                results.push_back(handler.readFile());
+            }
+
+    for (const auto& result : results)
+        check(testSupport::sameSections(result, results.front()), "every run ends with the same contents");
+
+    return check.result();
+}